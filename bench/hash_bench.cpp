@@ -0,0 +1,56 @@
+// key hash benchmark
+// hashes the same set of keys with the 64 bit keyhash::wyhash and with MurmurHash3_x86_32 for a
+// range of key lengths and prints the cost per hash and the throughput in bytes
+//
+// usage: hash_bench [bytes per length] (default 64 MiB)
+
+#include "storage/hash/keyhash.hpp"
+#include "storage/murmurhash/murmurhash3.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+template <typename Fn>
+static void timed(const char* name, size_t len, size_t ops, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t checksum = fn();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-10s %5zu B %8.2f ns/hash %8.2f GB/s  (check %llx)\n",
+                name, len, secs * 1e9 / (double)ops, (double)(ops * len) / secs / 1e9,
+                (unsigned long long)(checksum & 0xffff));
+}
+
+int main(int argc, char** argv) {
+    size_t budget = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (64u << 20);
+    const size_t lengths[] = { 3, 8, 16, 24, 32, 48, 64, 128, 256, 1024, 4096 };
+    const uint64_t seed = keyhash::seed();
+
+    for (size_t len : lengths) {
+        // 256 distinct keys at odd offsets of one buffer, so loads are not all aligned
+        const size_t keyCount = 256;
+        std::string pool(keyCount * (len + 1), '\0');
+        for (size_t i = 0; i < pool.size(); i++) pool[i] = (char)('a' + (i * 2654435761u >> 7) % 26);
+        std::vector<const char*> keys;
+        for (size_t i = 0; i < keyCount; i++) keys.push_back(pool.data() + i * (len + 1) + (i & 1));
+
+        size_t rounds = budget / len / keyCount + 1;
+        size_t ops = rounds * keyCount;
+
+        // every hash feeds the next seed, so calls can not be hoisted out or overlapped freely
+        timed("wyhash64", len, ops, [&] {
+            uint64_t h = seed;
+            for (size_t r = 0; r < rounds; r++)
+                for (const char* k : keys) h = keyhash::wyhash(k, len, h);
+            return h;
+        });
+        timed("murmur32", len, ops, [&] {
+            uint32_t h = (uint32_t)seed;
+            for (size_t r = 0; r < rounds; r++)
+                for (const char* k : keys) h = MurmurHash3_x86_32(k, (int)len, h);
+            return (uint64_t)h;
+        });
+    }
+    return 0;
+}
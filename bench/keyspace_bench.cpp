@@ -0,0 +1,102 @@
+// keyspace engine benchmark
+// built once per table engine (keyspace_bench_chained and keyspace_bench_swiss), both binaries run
+// the same add/get/exists/del workload through RedisHashMap so the numbers include hashing,
+// growth and incremental rehashing, plus the batched getMany path MGET uses, shrinking after
+// the deletes and loading into a reserved keyspace
+//
+// usage: keyspace_bench [keys] (default 1000000)
+
+#include "storage/RedisHashMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef KEYSPACE_SWISS_TABLE
+static const char* ENGINE = "swiss";
+#else
+static const char* ENGINE = "chained";
+#endif
+
+template <typename Fn>
+static void timed(const char* name, size_t ops, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    size_t checksum = fn();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-8s %-16s %10.1f ns/op %8.2f Mops/s  (check %zu)\n",
+                ENGINE, name, secs * 1e9 / (double)ops, (double)ops / secs / 1e6, checksum);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::vector<std::string> keys, misses;
+    keys.reserve(n);
+    misses.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        keys.push_back("key:" + std::to_string(i * 2654435761u % 1000000007u));
+        misses.push_back("miss:" + std::to_string(i));
+    }
+
+    RedisHashMap map(1024);
+    const std::string value = "value";
+
+    timed("add", n, [&] {
+        for (auto& k : keys) map.add(k, RedisObject(std::string_view(value)));
+        return n;
+    });
+    while (map.rehashFor(std::chrono::milliseconds(10))) {}
+
+    timed("get hit", n, [&] {
+        size_t found = 0;
+        for (auto& k : keys) found += map.get(k) != nullptr;
+        return found;
+    });
+    // the same lookups through getMany, PREFETCH_BATCH keys at a time like MGET does them
+    timed("get batched", n, [&] {
+        std::vector<std::string_view> views(keys.begin(), keys.end());
+        RedisObject* values[RedisHashMap::PREFETCH_BATCH];
+        size_t found = 0;
+        for (size_t first = 0; first < n; first += RedisHashMap::PREFETCH_BATCH) {
+            size_t count = std::min(RedisHashMap::PREFETCH_BATCH, n - first);
+            map.getMany(std::span<const std::string_view>(views).subspan(first, count), values);
+            for (size_t i = 0; i < count; i++) found += values[i] != nullptr;
+        }
+        return found;
+    });
+    timed("get miss", n, [&] {
+        size_t found = 0;
+        for (auto& k : misses) found += map.get(k) != nullptr;
+        return found;
+    });
+    timed("exists", n, [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < n; i++) found += map.exists(i % 2 ? keys[i] : misses[i]);
+        return found;
+    });
+    timed("overwrite", n, [&] {
+        for (auto& k : keys) map.add(k, RedisObject(std::string_view(value)));
+        return n;
+    });
+    timed("del", n, [&] {
+        size_t deleted = 0;
+        for (auto& k : keys) deleted += map.del(k);
+        return deleted;
+    });
+    // the deletes left the tables almost empty, idle ticks shrink them
+    size_t peak = map.capacity();
+    while (map.rehashFor(std::chrono::milliseconds(10))) {}
+    std::printf("%-8s capacity after del %zu -> %zu\n", ENGINE, peak, map.capacity());
+
+    // loading into a keyspace sized up front, no resize on the way
+    RedisHashMap reserved(1024);
+    reserved.reserve(n);
+    timed("add reserved", n, [&] {
+        for (auto& k : keys) reserved.add(k, RedisObject(std::string_view(value)));
+        return n;
+    });
+    return 0;
+}
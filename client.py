@@ -16,7 +16,7 @@ def main():
             if msg.lower() == "quit":
                 break
 
-            client.sendall(msg.encode())
+            client.sendall((msg + "\r\n").encode())  # inline commands end with a newline
 
             response = client.recv(4096)
             if not response:
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+// epoch based reclamation
+//
+// lets readers walk shared structures without locks. a reader wraps its access in an
+// epoch::Guard, a writer that unlinks an object hands it to retire() instead of deleting it.
+// the object is freed once every thread that was inside a guard when it was retired has left
+// that guard, which is tracked with a global epoch counter:
+//  - a guard records the global epoch it started in
+//  - the epoch only advances when every active guard has seen the current one
+//  - an object retired in epoch e is freed once the global epoch reaches e + 2
+//
+// threads register themselves on first use, there is no limit on the number of threads
+namespace epoch {
+
+class Guard {
+public:
+    Guard();
+    ~Guard();
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+};
+
+// frees p with deleter(p) once no guard can still see it
+void retire(void* p, void (*deleter)(void*));
+
+template <typename T>
+void retire(T* p) {
+    retire(static_cast<void*>(p), [](void* q) { delete static_cast<T*>(q); });
+}
+
+// tries to advance the epoch and frees whatever this thread retired that is now safe,
+// writers call it implicitly every few retires, idle loops may call it to drain faster
+void collect();
+
+// objects retired but not freed yet, over all threads
+uint64_t pending();
+
+} // namespace epoch
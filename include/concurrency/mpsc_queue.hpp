@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// bounded multi producer / single consumer ring (vyukov style)
+// every cell carries a sequence number: a producer may fill the cell for ticket pos when its
+// sequence equals pos and publishes it with pos + 1, the consumer hands it back to producers
+// with pos + capacity. producers only contend on the enqueue counter, the consumer never
+// writes anything producers spin on. messages of one producer come out in the order it pushed
+template <typename T>
+class MpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask = n - 1;
+        cells = std::make_unique<Cell[]>(n);
+        for (size_t i = 0; i < n; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // any thread, false when the ring is full
+    bool push(T value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only, false when the ring is empty
+    bool pop(T& out) {
+        Cell& cell = cells[dequeuePos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) return false;
+        out = std::move(cell.value);
+        cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    // consumer thread only, a push that is half way through counts as empty
+    bool empty() const {
+        return cells[dequeuePos & mask].sequence.load(std::memory_order_acquire) != dequeuePos + 1;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;
+};
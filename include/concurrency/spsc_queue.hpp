@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// bounded single producer / single consumer ring
+// exactly one thread pushes and one thread pops, so each side owns one index and only reads
+// the other one. both keep a cached copy of the other side's index and only reload it when the
+// ring looks full (producer) or empty (consumer), which keeps the shared cache lines quiet
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask = n - 1;
+        buffer = std::make_unique<T[]>(n);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer side, false when the ring is full
+    bool push(T value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) return false;
+        }
+        buffer[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when the ring is empty
+    bool pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) return false;
+        }
+        out = std::move(buffer[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::unique_ptr<T[]> buffer;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> head{0};   // next slot to pop, written by the consumer
+    size_t cachedTail = 0;                     // consumer's view of tail
+    alignas(64) std::atomic<size_t> tail{0};   // next slot to push, written by the producer
+    size_t cachedHead = 0;                     // producer's view of head
+};
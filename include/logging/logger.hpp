@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// asynchronous leveled logger
+// a log call formats its parts straight into a slot of a bounded lock-free ring and returns,
+// one background thread drains the ring, stamps the lines with a cached timestamp and writes
+// them to stdout in batches. when the ring is full the message is dropped and counted instead
+// of blocking the caller
+//
+// levels are filtered twice:
+//  - at compile time with LOG_COMPILE_LEVEL (0 debug .. 4 off), calls below it are not emitted
+//  - at run time with setLevel(), a disabled call is one relaxed load and a branch, none of its
+//    arguments are evaluated
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+namespace logging {
+
+enum class Level : int { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+// bytes of message text per ring slot, longer messages are truncated
+constexpr size_t MAX_MESSAGE = 232;
+// number of slots in the ring, must be a power of two
+constexpr size_t RING_SIZE = 8192;
+
+extern std::atomic<int> runtimeLevel;
+
+inline bool enabled(Level lvl) {
+    return (int)lvl >= runtimeLevel.load(std::memory_order_relaxed);
+}
+
+void setLevel(Level lvl);
+Level getLevel();
+// parses "debug", "info", "warn", "error" or "off", returns false for anything else
+bool parseLevel(std::string_view name, Level& out);
+
+// starts the writer thread, the runtime level is taken from the LOG_LEVEL environment variable
+// when it is set. messages logged before init() wait in the ring
+void init();
+// drains whatever is still queued and stops the writer thread
+void shutdown();
+
+// number of messages dropped because the ring was full
+uint64_t droppedCount();
+
+// fixed size line being built inside a ring slot
+class LineBuilder {
+public:
+    LineBuilder(char* buffer, size_t capacity) : buf(buffer), cap(capacity) {}
+
+    void append(std::string_view s) {
+        size_t n = s.size() < cap - len ? s.size() : cap - len;
+        for (size_t i = 0; i < n; i++) buf[len + i] = s[i];
+        len += n;
+    }
+    void append(const char* s) { append(std::string_view(s)); }
+    void append(const std::string& s) { append(std::string_view(s)); }
+    void append(char c) { if (len < cap) buf[len++] = c; }
+    void append(bool b) { append(b ? std::string_view("true") : std::string_view("false")); }
+
+    template <typename T>
+    std::enable_if_t<std::is_arithmetic_v<T>> append(T v) {
+        auto res = std::to_chars(buf + len, buf + cap, v);
+        if (res.ec == std::errc()) len = (size_t)(res.ptr - buf);
+    }
+
+    // pointers are printed as addresses
+    void append(const void* p) {
+        append("0x");
+        auto res = std::to_chars(buf + len, buf + cap, (uintptr_t)p, 16);
+        if (res.ec == std::errc()) len = (size_t)(res.ptr - buf);
+    }
+
+    size_t size() const { return len; }
+
+private:
+    char* buf;
+    size_t cap;
+    size_t len = 0;
+};
+
+// one slot of the ring, sequence tells producers and the writer who owns it
+struct Record {
+    std::atomic<size_t> sequence;
+    Level level;
+    uint16_t length;
+    char text[MAX_MESSAGE];
+};
+
+// claims a free slot, returns nullptr (and counts the drop) when the ring is full
+Record* claim();
+// hands a filled slot over to the writer
+void publish(Record* r);
+
+template <typename... Parts>
+void write(Level lvl, const Parts&... parts) {
+    Record* r = claim();
+    if (!r) return;
+    LineBuilder line(r->text, MAX_MESSAGE);
+    (line.append(parts), ...);
+    r->level = lvl;
+    r->length = (uint16_t)line.size();
+    publish(r);
+}
+
+} // namespace logging
+
+#define LOG_AT(lvl, ...)                                                   \
+    do {                                                                   \
+        if constexpr ((int)(lvl) >= LOG_COMPILE_LEVEL) {                   \
+            if (logging::enabled(lvl)) logging::write((lvl), __VA_ARGS__); \
+        }                                                                  \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(logging::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(logging::Level::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(logging::Level::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(logging::Level::Error, __VA_ARGS__)
@@ -1,33 +1,100 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <span>
 #include <vector>
-#include <functional>
-#include <unordered_map>
 #include "storage/RedisHashMap.hpp"
+#include "parser/reply.hpp"
+
+class TTLPriorityQueue;
 
 class Parser {
 private:
     RedisHashMap& baseMap;  // reference to shared map
+    bool lockFree = false;  // baseMap is private to the calling thread
+    TTLPriorityQueue* ttl = nullptr;  // its expiry queue in lock-free mode
 
 public:
+    // command arguments, views into the connection buffer the request was read from
+    using Args = std::span<const std::string_view>;
+
     Parser(RedisHashMap& map);  // constructor injection
-    // This is the ONLY function you call from your server
-    std::string route(const std::string& rawInput);
+    // lock-free mode, for a keyspace only the calling thread ever touches (a core of the
+    // shared-nothing server): commands take no shard locks and keys expire from the caller's
+    // event loop through expireKeys() instead of a background thread
+    Parser(RedisHashMap& map, bool threadPrivate);
+    // Runs a single whitespace separated command line and returns the RESP reply, the server
+    // itself frames requests with RespDecoder and calls processCommand directly
+    std::string route(std::string_view rawInput);
+
+    // runs one request and serializes its reply into out
+    void processCommand(Args tokens, ReplyWriter& out);
+    // runs a pipelined batch, argc[i] tokens per request laid out back to back in args.
+    // the first key of every request in a window of PIPELINE_WINDOW is prefetched before the
+    // window runs, so the cache misses of independent requests overlap
+    static constexpr size_t PIPELINE_WINDOW = RedisHashMap::PREFETCH_BATCH;
+    void processBatch(Args args, std::span<const uint32_t> argc, ReplyWriter& out);
+    std::vector<std::string_view> tokenize(std::string_view input);
 
-    // internal helpers
-    std::string processCommand(const std::vector<std::string>& tokens);
-    std::vector<std::string> tokenize(const std::string& input);
+    // background maintenance (incremental rehashing) the server runs when no client is active
+    // idleWork() does a small time boxed slice of it and returns true while more is pending
+    bool hasIdleWork() const;
+    bool idleWork();
+    // lock-free mode only: deletes the keys whose ttl ran out and returns how long the loop may
+    // wait before the next one does, in milliseconds (-1 when no key has a ttl)
+    int expireKeys();
 
     // Command registry types
-    using HandlerFn = std::function<std::string(RedisHashMap&, const std::vector<std::string>&)>;
+    using HandlerFn = void (*)(RedisHashMap&, Args, ReplyWriter&);
+    // lock-free variant of a read command, answers from the key snapshots in read optimized mode
+    using SnapshotFn = void (*)(const RedisHashMap&, Args, ReplyWriter&);
+
+    // command flags, they decide how the shards of the command's keys are locked
+    static constexpr uint32_t CMD_READ = 1;    // only reads its keys, shard locks are shared
+    static constexpr uint32_t CMD_WRITE = 2;   // modifies or creates keys, shard locks are exclusive
+
+    // where the keys are in the argument list, like redis' first/last/step key specs
+    struct KeySpec {
+        int first;   // index of the first key, 0 when the command takes no keys
+        int last;    // index of the last key, negative counts from the end (-1 == last token)
+        int step;    // distance between two keys, 2 for key value pairs
+    };
 
     struct CommandSpec {
+        std::string_view name;   // uppercase command name
         HandlerFn handler;
         int minArgs;   // minimum token count (including command name)
         int maxArgs;   // maximum token count; -1 == unbounded
-        std::string help; // (optional) short help text
+        std::string_view help; // (optional) short help text
+        KeySpec keys;
+        uint32_t flags;
+        SnapshotFn snapshotRead = nullptr;   // set for the reads that have a lock-free path
     };
 
+    // true when the token count (including the command name) fits the command's arity
+    static bool arityOk(const CommandSpec& spec, size_t tokenCount) {
+        return tokenCount >= (size_t)spec.minArgs &&
+               (spec.maxArgs == -1 || tokenCount <= (size_t)spec.maxArgs);
+    }
+
+    // calls fn with the index of every key token of the request, following the key spec
+    template <typename Fn>
+    static void forEachKey(const CommandSpec& spec, size_t tokenCount, Fn fn) {
+        if (spec.keys.first <= 0) return;
+        int count = (int)tokenCount;
+        int last = spec.keys.last < 0 ? count + spec.keys.last : spec.keys.last;
+        if (last >= count) last = count - 1;
+        for (int i = spec.keys.first; i <= last; i += spec.keys.step) fn((size_t)i);
+    }
+
+    // the shards holding the keys of a request, as a mask for RedisHashMap::ShardGuard
+    uint64_t keyShards(const CommandSpec& spec, Args tokens) const;
+    // refreshes the read snapshots of every key of a write, called while its shards are locked
+    void publishKeys(const CommandSpec& spec, Args tokens);
+
+    // case insensitive lookup in the compile time command table, nullptr if unknown
+    static const CommandSpec* lookupCommand(std::string_view name);
+
     // Exposed for unit tests if needed
-    static const std::unordered_map<std::string, CommandSpec>& getCommandTable();
+    static std::span<const CommandSpec> getCommandTable();
 };
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// typed reply writer
+// command handlers describe their reply with these calls and the writer serializes it as RESP2
+// straight into the connection's output buffer, so no per command reply string is built and
+// nothing is copied again on the way to send()
+//
+// a writer in RECORDS format keeps the typed calls instead: one tag byte per call followed by
+// the raw number or the length and the bytes. a thread that runs commands for others (the
+// executor of the i/o server) fills records and the thread owning the client turns them into
+// RESP with render(), so the formatting is paid where the socket is
+class ReplyWriter {
+public:
+    enum class Format { RESP, RECORDS };
+
+    explicit ReplyWriter(std::string& buffer, Format format = Format::RESP)
+        : out(buffer), records(format == Format::RECORDS) {}
+
+    void ok();
+    void simple(std::string_view s);      // +<s>
+    void error(std::string_view msg);     // -<msg>, msg starts with the error code e.g. "ERR ..."
+    void integer(long long n);            // :<n>
+    void bulk(std::string_view s);        // $<len> followed by the bytes
+    void bulk(long long n);               // the digits of n as a bulk string, for numbers kept as numbers
+    void nil();
+    void arrayHeader(size_t n);           // *<n>, followed by n more replies
+
+    // lets the dispatcher drop a half written reply when a handler throws
+    size_t mark() const { return out.size(); }
+    void rollback(size_t m) { out.resize(m); }
+
+    // appends the RESP form of a buffer written in RECORDS format to resp
+    static void render(std::string_view recorded, std::string& resp);
+
+private:
+    void prefixed(char type, long long n);
+    void record(char tag, long long n);
+    void record(char tag, std::string_view s);
+
+    std::string& out;
+    bool records;
+};
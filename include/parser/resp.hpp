@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// incremental request decoder for the redis wire protocol (RESP2)
+// understands multi bulk requests like *2\r\n$3\r\nGET\r\n$1\r\nk\r\n as sent by redis-cli and client
+// libraries, and plain inline commands terminated by a newline as typed into netcat
+//
+// the decoder never owns the bytes, the caller keeps them in its own buffer and passes the unconsumed
+// part on every call. the scan position, the number of arguments still expected and the length of the
+// bulk being waited on are kept between calls, so a request split over many tcp segments is framed
+// without scanning the earlier segments again and a bulk value of any size is waited for with a single
+// length check
+class RespDecoder {
+public:
+    enum class Result {
+        Incomplete,   // need more bytes
+        Command,      // a full request is framed, see args() and consumed()
+        Error         // the stream is not valid RESP, see error()
+    };
+
+    // an argument as a slice of the caller's buffer, relative to the data pointer given to decode()
+    struct ArgRange {
+        size_t offset;
+        size_t length;
+    };
+
+    // data must point at the first unconsumed byte and stay the same between calls
+    // until a Command is returned, len is the number of bytes available from there
+    Result decode(const char* data, size_t len);
+
+    // valid after decode() returned Command
+    const std::vector<ArgRange>& args() const { return argRanges; }
+    size_t consumed() const { return pos; }
+
+    // valid after decode() returned Error
+    const char* error() const { return errorMsg; }
+
+    // forget the framed request, the caller must advance its data pointer by consumed() first
+    void reset();
+
+    // protocol limits, the same ones redis uses
+    static const long long MAX_MULTIBULK_LEN = 1024 * 1024;
+    static const long long MAX_BULK_LEN = 512LL * 1024 * 1024;
+    static const size_t MAX_INLINE_LEN = 64 * 1024;
+
+private:
+    enum class Mode { Unknown, Inline, Multibulk };
+
+    Result decodeInline(const char* data, size_t len);
+    Result decodeMultibulk(const char* data, size_t len);
+
+    // finds the end of the line starting at pos, returns false if it has not arrived yet
+    bool findLine(const char* data, size_t len, size_t& lineEnd, size_t& next);
+    Result fail(const char* msg);
+
+    Mode mode = Mode::Unknown;
+    size_t pos = 0;              // first byte not yet framed
+    size_t scanPos = 0;          // where to continue looking for a newline
+    long long multibulkLen = 0;  // arguments still expected
+    long long bulkLen = -1;      // length of the bulk being waited on, -1 while reading its header
+    std::vector<ArgRange> argRanges;
+    const char* errorMsg = "";
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser/resp.hpp"
+
+class Parser;
+
+// protocol state of one client, shared by the socket backends
+// the backend appends whatever it receives to inBuf and sends whatever is queued in outBuf,
+// everything in between (request framing and reply queuing) happens here
+struct Connection {
+    int fd = -1;
+
+    std::string inBuf;        // bytes received from the client
+    size_t inPos = 0;         // start of the first request not yet consumed
+    std::string outBuf;       // replies waiting to be sent
+    size_t outPos = 0;        // bytes of outBuf already written to the socket
+
+    RespDecoder decoder;
+    // arguments of the request returned by nextRequest(), these are views into inBuf and stay
+    // valid until compactInput() is called or more bytes are appended
+    std::vector<std::string_view> args;
+    // every complete request of the last read, flattened for Parser::processBatch
+    std::vector<std::string_view> batchArgs;
+    std::vector<uint32_t> batchArgc;
+    bool closing = false;            // protocol error or eof seen, close once outBuf is sent
+    bool writeBlocked = false;       // last send hit EAGAIN, wait for the socket to drain
+
+    // frames the next complete request from inBuf into args
+    // returns false when more bytes are needed or the stream is broken (closing is then set and
+    // the error reply is already queued)
+    bool nextRequest();
+
+    // drops the consumed requests from the front of inBuf
+    void compactInput();
+
+    // runs every complete request currently buffered and queues all of their replies in outBuf
+    // so a pipelined batch is answered with one write instead of one write per command. all the
+    // requests are framed first and then run as one batch, which lets the parser prefetch their keys
+    // returns the number of requests executed
+    size_t executePending(Parser& parser);
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "concurrency/spsc_queue.hpp"
+#include "parser/parser.hpp"
+#include "server/connection.hpp"
+#include "storage/RedisHashMap.hpp"
+
+// shared-nothing server, one thread per core (linux only)
+//
+// every core owns a private keyspace, parser and epoll loop with its own SO_REUSEPORT listener.
+// the parser runs lock-free over it and the loop expires its keys between events.
+// a key belongs to exactly one core, picked from its keyhash. the core a client is connected
+// to reads and frames its requests, runs the ones it owns and hands the rest to the owning core
+// through a lock-free single producer / single consumer queue. the owner runs the command and
+// sends the serialized reply back the same way, replies are put back into request order per
+// client before they are written
+//
+// multi-key commands whose keys live on different cores are split: MGET, MSET, DEL and EXISTS
+// fan out one piece per core (per key for MGET) and the origin gathers the answers. any other command over
+// keys of several cores is refused with CROSSSLOT, like redis cluster does
+class CoreServer {
+public:
+    // capacity is the number of keys the whole server is sized for up front, 0 to grow on demand
+    CoreServer(int port, int cores, size_t capacity = 0);
+    ~CoreServer();
+
+    bool start();
+    void stop();
+
+private:
+    // a command travelling between two cores, the same object goes there and back
+    struct Message {
+        uint32_t origin;                  // core the client is connected to
+        uint64_t client;                  // client id on the origin core
+        uint64_t seq;                     // reply slot of the request on that client
+        uint32_t part;                    // piece of a fanned out command
+        bool done = false;                // reply is filled in, the message is on its way back
+        std::vector<std::string> args;    // owned copy, the client's buffer moves on
+        std::string reply;
+    };
+
+    // how the pieces of a fanned out command are put back together
+    enum class Gather : uint8_t { None, Array, AllOk, Sum, Scan };
+
+    // a reply that is not ready yet, or ready but queued behind one that is not
+    struct Slot {
+        std::string reply;
+        uint32_t missing = 0;             // pieces still out on other cores
+        Gather gather = Gather::None;
+        std::vector<std::string> parts;   // Gather::Array elements in key order
+        long long total = 0;              // Gather::Sum of the integer replies so far
+    };
+
+    struct Client {
+        Connection conn;
+        std::deque<Slot> slots;           // replies still owed, in request order
+        uint64_t firstSeq = 0;            // sequence number of slots.front()
+    };
+
+    struct Core {
+        uint32_t index = 0;
+        std::unique_ptr<RedisHashMap> map;
+        std::unique_ptr<Parser> parser;
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;                  // eventfd other cores write to after queueing messages
+        uint64_t nextClientId = FIRST_CLIENT_ID;
+        std::unordered_map<uint64_t, Client> clients;
+        std::vector<std::deque<Message*>> backlog;   // per target, waiting for room in its queue
+        std::vector<char> needsWake;                 // per target, queued to since the last wake
+        std::vector<uint64_t> dirty;                 // clients with new output to flush
+        std::vector<std::string_view> scratch;       // arguments of the message being run
+    };
+
+    // epoll tags of the two non client descriptors, clients are tagged with their id
+    static constexpr uint64_t LISTEN_ID = 0;
+    static constexpr uint64_t WAKE_ID = 1;
+    static constexpr uint64_t FIRST_CLIENT_ID = 2;
+
+    int port;
+    uint32_t coreCount;
+    size_t capacity;
+    std::atomic<bool> running{false};
+    std::vector<std::unique_ptr<Core>> cores;
+    // queues[from * coreCount + to], one ring per ordered pair of cores
+    std::vector<std::unique_ptr<SpscQueue<Message*>>> queues;
+
+    uint32_t ownerOf(std::string_view key) const;
+    SpscQueue<Message*>& queue(uint32_t from, uint32_t to) { return *queues[from * coreCount + to]; }
+
+    bool openCore(Core& core);
+    void runCore(Core& core);
+    void acceptClients(Core& core);
+    bool handleRead(Core& core, Client& client, uint64_t id);   // false when the client must be closed
+    void closeClient(Core& core, uint64_t id);
+
+    // request side
+    void route(Core& core, Client& client, uint64_t id, Parser::Args args);
+    // SCAN has no key to route by, the core it walks is picked from the cursor
+    void routeScan(Core& core, Client& client, uint64_t id, Parser::Args args);
+    // the client's reply goes straight to its output unless earlier replies are still owed
+    std::string& replyTarget(Client& client);
+    void send(Core& core, uint32_t target, Message* msg);
+    Message* makeMessage(Core& core, uint64_t id, uint64_t seq, uint32_t part, Parser::Args args);
+    bool flushBacklog(Core& core);   // true while some target is still full
+    void wakeTargets(Core& core);
+
+    // reply side
+    bool drainInbox(Core& core);   // true when it stopped early with messages left
+    void deliver(Core& core, Message* msg);
+    void gatherPart(Slot& slot, std::string&& reply, uint32_t part) const;
+    void completeSlots(Client& client);
+    void flushDirty(Core& core);
+};
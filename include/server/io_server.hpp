@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "concurrency/mpsc_queue.hpp"
+#include "concurrency/spsc_queue.hpp"
+#include "parser/parser.hpp"
+#include "server/connection.hpp"
+
+// threaded i/o with a single executor (linux only)
+//
+// a pool of i/o threads owns the sockets: each runs an epoll loop with its own SO_REUSEPORT
+// listener, receives, frames the pipelined requests of a read and copies them into one batch.
+// batches go to the executor thread through a multi producer / single consumer ring, the
+// executor runs every command of the batch with Parser::processCommand, so all commands are
+// executed by one thread, one after the other, like in a single threaded server. the executor
+// writes the results as typed reply records (ReplyWriter RECORDS format), they go back to the
+// batch's i/o thread through a single producer / single consumer ring and the i/o thread
+// serializes them to RESP and does the sending
+class IoServer {
+public:
+    IoServer(int port, Parser& parser, int ioThreads);
+    ~IoServer();
+
+    bool start();
+    void stop();
+
+private:
+    // the requests of one read of one client, copied out of its buffer, and their replies
+    struct Batch {
+        uint32_t loop;                    // i/o thread that owns the client
+        uint64_t client;                  // client id on that thread
+        std::string input;                // raw bytes of the requests
+        std::vector<uint32_t> argc;       // argument count of every request
+        std::vector<std::pair<uint32_t, uint32_t>> args;   // offset and length in input
+        std::string reply;                // reply records, filled in by the executor
+    };
+
+    struct Client {
+        Connection conn;
+        uint32_t inFlight = 0;            // batches at the executor
+        std::string pendingError;         // protocol error held back until inFlight drops to 0
+    };
+
+    struct IoLoop {
+        uint32_t index = 0;
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;                  // written by the executor after queueing replies
+        uint64_t nextClientId = FIRST_CLIENT_ID;
+        std::unordered_map<uint64_t, Client> clients;
+        std::deque<Batch*> backlog;       // batches waiting for room in the executor ring
+        std::unique_ptr<SpscQueue<Batch*>> replies;
+    };
+
+    static constexpr uint64_t LISTEN_ID = 0;
+    static constexpr uint64_t WAKE_ID = 1;
+    static constexpr uint64_t FIRST_CLIENT_ID = 2;
+
+    Parser& parser;
+    int port;
+    uint32_t loopCount;
+    std::atomic<bool> running{false};
+    std::vector<std::unique_ptr<IoLoop>> loops;
+
+    // executor side
+    MpscQueue<Batch*> requests;
+    int executorWakeFd = -1;
+    std::atomic<bool> executorSleeping{false};
+
+    bool openLoop(IoLoop& loop);
+    void runLoop(IoLoop& loop);
+    void acceptClients(IoLoop& loop);
+    bool handleRead(IoLoop& loop, Client& client, uint64_t id);   // false when the client must be closed
+    void closeClient(IoLoop& loop, uint64_t id);
+    bool submit(IoLoop& loop);          // true while batches are still waiting in the backlog
+    void receiveReplies(IoLoop& loop);
+
+    void runExecutor();
+};
@@ -1,31 +1,63 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
-#include <string>
-#include "parser/parser.hpp"
 
 #pragma comment(lib, "ws2_32.lib")
+#endif
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "parser/parser.hpp"
+#include "server/connection.hpp"
 
 class TcpServer {
 public:
-    TcpServer(int port, Parser& parser);   // constructor updated
+    // threads is the number of event loops on linux, they share the (sharded) keyspace
+    // the windows backend runs one thread per client and ignores it
+    TcpServer(int port, Parser& parser, int threads = 1);
     ~TcpServer();
 
     bool start();
     void stop();
 
 private:
+#ifdef _WIN32
     static DWORD WINAPI clientThread(LPVOID param);
     void handleClient(SOCKET clientSocket);
+#else
+    // one reactor per thread, each with its own listening socket (SO_REUSEPORT lets the kernel
+    // spread new clients over them), epoll instance and connections, so loops share nothing
+    // but the parser and the keyspace behind it
+    struct EventLoop {
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;      // eventfd used by stop() to wake the loop
+        std::unordered_map<int, Connection> connections;
+    };
+
+    bool openLoop(EventLoop& loop);
+    void runLoop(EventLoop& loop);
+    void acceptClients(EventLoop& loop);
+    bool handleRead(Connection& conn);    // false when the connection must be closed
+    void closeConnection(EventLoop& loop, int fd);
+#endif
     Parser& parser;   // dependency injection
 private:
     int port;
+    int threadCount;
+    std::atomic<bool> running;
+#ifdef _WIN32
     SOCKET serverSocket;
-    bool running;
-    CRITICAL_SECTION cs;  // for thread-safe shared data
+#else
+    std::vector<std::unique_ptr<EventLoop>> loops;
+#endif
 };
 
 #endif
@@ -0,0 +1,23 @@
+#pragma once
+#include "server/connection.hpp"
+
+// non blocking socket plumbing shared by the linux servers (epoll reactors and thread per core)
+namespace sockio {
+
+// listening socket on every interface, reusePort lets several loops bind the same port and
+// have the kernel spread new clients over them. returns -1 after logging on failure
+int openListener(int port, bool reusePort);
+
+// accepts one pending client as a non blocking socket with nagle off
+// returns -1 once nothing is left to accept
+int acceptClient(int listenFd);
+
+// appends everything the socket has to conn.inBuf until it would block
+// returns false on a hard socket error, peerClosed is set when the client sent eof
+bool readAvailable(Connection& conn, bool& peerClosed);
+
+// writes as much of the pending output as the socket accepts, anything left over waits for
+// the socket to become writable again (writeBlocked is set). false when the connection is broken
+bool flushWrites(Connection& conn);
+
+} // namespace sockio
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "storage/HashEntry.hpp"
+
+// separate chaining engine for RedisHashMap, every bucket is a small vector of entries
+//
+// both table engines (this one and SwissTable) expose the same interface so RedisHashMap can
+// drive either of them: lookups get the 64 bit keyhash of the key, and resizing is done by
+// RedisHashMap moving one migration unit (here a bucket) at a time into a bigger table
+class ChainedTable {
+public:
+    // capacity is rounded up to a power of two, a bucket is picked by the low bits of the hash
+    explicit ChainedTable(size_t capacity = 0);
+
+    size_t capacity() const { return buckets.size(); }
+    size_t size() const { return count; }
+
+    HashEntry* find(std::string_view key, KeyHash hash);
+    // the key must not be present yet
+    HashEntry* insert(std::string_view key, RedisObject&& value, KeyHash hash);
+    bool erase(std::string_view key, KeyHash hash);
+
+    // batched lookups touch the bucket first and its entries second, each stage is prefetched
+    // for the whole batch before the next one runs
+    void prefetchBucket(KeyHash hash) const { prefetchRead(&buckets[bucketOf(hash)]); }
+    void prefetchEntries(KeyHash hash) const {
+        auto& bucket = buckets[bucketOf(hash)];
+        if (!bucket.empty()) prefetchRead(bucket.data());
+    }
+
+    // ---------- resizing ----------
+    bool overloaded() const { return count > capacity() * 3 / 4; }   // load factor 0.75
+    bool underloaded() const { return count * 10 < capacity(); }   // load factor below 0.1
+    size_t grownCapacity() const { return capacity() * 2; }
+    // smallest power of two bucket count that holds keys without being overloaded
+    static size_t capacityFor(size_t keys) {
+        size_t n = 16;
+        while (keys > n / 4 * 3) n <<= 1;
+        return n;
+    }
+    size_t migrationUnits() const { return buckets.size(); }
+    // moves every entry of one bucket into dest, returns the number of entries moved
+    size_t migrate(size_t unit, ChainedTable& dest);
+
+    // ---------- scanning ----------
+    // SCAN walks a table by home bucket: the keys of bucket i are found in buckets i and
+    // i + capacity() of a table twice the size, which lets a cursor survive resizes
+    size_t scanUnits() const { return buckets.size(); }
+    void scanUnit(size_t unit, std::vector<const HashEntry*>& out) const;
+
+private:
+    std::vector<std::vector<HashEntry>> buckets;
+    size_t count = 0;
+
+    size_t bucketOf(KeyHash hash) const { return hash & (buckets.size() - 1); }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "storage/RedisObject.hpp"
+#include "storage/hash/keyhash.hpp"
+
+#if !defined(__GNUC__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// hash of a key as the keyspace uses it (keyhash::hash), computed once per operation and stored
+// in the entry
+using KeyHash = uint64_t;
+
+// one key/value pair of the keyspace, shared by the table engines
+// the hash is kept next to the key so lookups can reject most candidates without touching the
+// key bytes and a resize never has to hash a key again
+struct HashEntry {
+    std::string key;
+    KeyHash hash;
+    RedisObject value;
+
+    HashEntry(std::string_view k, KeyHash h, const RedisObject& v)
+        : key(k), hash(h), value(v) {}
+    HashEntry(std::string_view k, KeyHash h, RedisObject&& v)
+        : key(k), hash(h), value(std::move(v)) {}
+
+    bool matches(std::string_view k, KeyHash h) const { return hash == h && key == k; }
+};
+
+// pulls the cache line at p in ahead of a lookup, only a hint so it never faults
+inline void prefetchRead(const void* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p, 0, 3);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
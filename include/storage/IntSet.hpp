@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// a SET of integers as one sorted array, intset style
+//
+// the values are stored as 16, 32 or 64 bit, whatever the widest member needs, and the array is
+// widened in one go when a member outside the current range arrives (it never narrows again).
+// lookups binary search down to a short window and compare that window at once with SSE2.
+// a set stays an IntSet while every member is an integer in canonical form and it has at most
+// maxEntries members, RedisObject converts it to SetMembers for good otherwise
+//
+// an IntSet is the head of a single block: width, count and capacity, with the members right
+// behind it like the bytes of an embedded string. RedisObject allocates the block after its
+// reference count and builds a new one when a member needs more room or a wider type, the
+// IntSet itself only ever edits within its capacity
+class IntSet {
+public:
+    // the limit, set once at startup before any set exists
+    static inline size_t maxEntries = 512;
+
+    // bytes the members of a block take behind the head
+    static size_t bytesFor(uint8_t width, size_t capacity) { return (size_t)width * capacity; }
+    // the member width in bytes, 2, 4 or 8, that holds v
+    static uint8_t widthFor(int64_t v);
+
+    IntSet(uint8_t width, uint32_t capacity) : cap(capacity), width(width) {}
+    IntSet(const IntSet&) = delete;
+    IntSet& operator=(const IntSet&) = delete;
+
+    size_t size() const { return count; }
+    size_t capacity() const { return cap; }
+    uint8_t memberWidth() const { return width; }
+    // true when v can be inserted in place, without a bigger or wider block
+    bool hasRoomFor(int64_t v) const { return count < cap && widthFor(v) <= width; }
+
+    bool contains(int64_t v) const;
+    bool insert(int64_t v);   // true when it is new, needs hasRoomFor(v)
+    bool erase(int64_t v);
+    int64_t at(size_t i) const;   // the i-th smallest member
+    // copies the members of other, widened to this set's width, into this empty set
+    void copyFrom(const IntSet& other);
+
+    // fn(members) with the members as a span of their stored type
+    template <typename Fn>
+    decltype(auto) withMembers(Fn&& fn) const {
+        if (width == 2) return fn(std::span<const int16_t>(members<int16_t>(), count));
+        if (width == 4) return fn(std::span<const int32_t>(members<int32_t>(), count));
+        return fn(std::span<const int64_t>(members<int64_t>(), count));
+    }
+
+    // fn(v) for every member in ascending order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        withMembers([&](auto vec) {
+            for (auto v : vec) fn((int64_t)v);
+        });
+    }
+
+    // ---------- Merges ----------
+    // both sets are walked once side by side, out(v) gets every value of the result in
+    // ascending order
+    template <typename Out>
+    static void intersect(const IntSet& a, const IntSet& b, Out&& out);
+    template <typename Out>
+    static void unite(const IntSet& a, const IntSet& b, Out&& out);
+    // the members of a that b does not have
+    template <typename Out>
+    static void difference(const IntSet& a, const IntSet& b, Out&& out);
+
+private:
+    uint32_t count = 0;
+    uint32_t cap;
+    uint8_t width;
+
+    // the members start right after the head
+    template <typename T>
+    T* members() { return reinterpret_cast<T*>(this + 1); }
+    template <typename T>
+    const T* members() const { return reinterpret_cast<const T*>(this + 1); }
+    template <typename T>
+    bool insertAs(int64_t v);
+    template <typename T>
+    bool eraseAs(int64_t v);
+};
+
+template <typename Out>
+void IntSet::intersect(const IntSet& a, const IntSet& b, Out&& out) {
+    a.withMembers([&](auto x) {
+        b.withMembers([&](auto y) {
+            size_t i = 0, j = 0;
+            while (i < x.size() && j < y.size()) {
+                int64_t u = x[i], v = y[j];
+                if (u < v) i++;
+                else if (v < u) j++;
+                else {
+                    out(u);
+                    i++;
+                    j++;
+                }
+            }
+        });
+    });
+}
+
+template <typename Out>
+void IntSet::unite(const IntSet& a, const IntSet& b, Out&& out) {
+    a.withMembers([&](auto x) {
+        b.withMembers([&](auto y) {
+            size_t i = 0, j = 0;
+            while (i < x.size() && j < y.size()) {
+                int64_t u = x[i], v = y[j];
+                if (u <= v) i++;
+                if (v <= u) j++;
+                out(u < v ? u : v);
+            }
+            for (; i < x.size(); i++) out((int64_t)x[i]);
+            for (; j < y.size(); j++) out((int64_t)y[j]);
+        });
+    });
+}
+
+template <typename Out>
+void IntSet::difference(const IntSet& a, const IntSet& b, Out&& out) {
+    a.withMembers([&](auto x) {
+        b.withMembers([&](auto y) {
+            size_t j = 0;
+            for (size_t i = 0; i < x.size(); i++) {
+                int64_t u = x[i];
+                while (j < y.size() && y[j] < u) j++;
+                if (j == y.size() || y[j] != u) out(u);
+            }
+        });
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+#include "storage/HashEntry.hpp"
+#include "storage/ReadIndex.hpp"
+
+// the table engine is picked at build time (cmake option KEYSPACE_SWISS_TABLE)
+#ifdef KEYSPACE_SWISS_TABLE
+#include "storage/SwissTable.hpp"
+using KeyTable = SwissTable;
+#else
+#include "storage/ChainedTable.hpp"
+using KeyTable = ChainedTable;
+#endif
+
+// one hash partition of the keyspace
+// a shard owns its tables, resizes on its own and carries the reader-writer lock that commands
+// take before touching its keys. none of the methods lock by themselves, the caller holds
+// the lock (see RedisHashMap::ShardGuard)
+//
+// resizing is incremental: when the table is overloaded a bigger one is put in tables[1]
+// and every write moves a few buckets of tables[0] over to it, idle ticks move more.
+// lookups check both tables until tables[0] is empty and the new table takes its place.
+// a table that deletes left mostly empty (see underloaded() of the engine) shrinks the same way,
+// never below the capacity the shard was created or reserved with. like redis does from its cron,
+// the shrink is only started by an idle tick so a burst of deletes is not slowed down by it
+class alignas(64) KeyspaceShard {
+public:
+    KeyspaceShard(size_t id, size_t capacity);
+
+    std::shared_mutex lock;
+    // snapshots for lock-free readers, only allocated in read optimized mode
+    std::unique_ptr<ReadIndex> readIndex;
+
+    HashEntry* find(std::string_view key, KeyHash hash);
+    // inserts or overwrites, returns true when the key is new
+    bool insert(std::string_view key, RedisObject&& value, KeyHash hash);
+    // the key must not be present (the caller just missed it with find), skips insert's lookup
+    HashEntry* insertNew(std::string_view key, RedisObject&& value, KeyHash hash);
+    bool erase(std::string_view key, KeyHash hash);
+    // moves the value out and removes the key, empty when it does not exist
+    std::optional<RedisObject> extract(std::string_view key, KeyHash hash);
+
+    // cache hints for batched lookups (RedisHashMap::getMany), both tables while rehashing
+    void prefetchBucket(KeyHash hash) const;
+    void prefetchEntries(KeyHash hash) const;
+
+    size_t size() const { return count; }
+    size_t capacity() const { return tables[0].capacity(); }
+    // sizes the shard for this many keys right away and keeps it from shrinking below that
+    void reserve(size_t keys);
+
+    // ---------- Incremental rehashing ----------
+    // readable without holding the lock, lets idle ticks skip shards with nothing to do
+    bool isRehashing() const { return rehashing.load(std::memory_order_relaxed); }
+    // deletes left the table sparse, the next idle tick starts a shrink (also readable unlocked)
+    bool wantsShrink() const { return shrinkWanted.load(std::memory_order_relaxed); }
+    // starts moving to a smaller table if the shard is still sparse, the caller holds it exclusively
+    void shrinkIfSparse();
+    // migrates up to n non empty buckets, returns true while there is still work left
+    bool rehashStep(size_t n);
+
+    // ---------- Scanning ----------
+    // one step of a reverse binary cursor (the one redis' dictScan uses): appends the entries of
+    // the bucket the cursor points at, in both tables while rehashing, and returns the next
+    // cursor, 0 once the shard is done. incrementing the cursor from its top bit down means the
+    // buckets already visited map onto buckets already visited in a table of any other power of
+    // two size, so no key that stays in the shard is missed when it resizes between two steps
+    uint64_t scan(uint64_t cursor, std::vector<const HashEntry*>& out) const;
+
+private:
+    size_t id;                        // shard number, only used in logs
+    KeyTable tables[2];
+    size_t rehashIdx = 0;             // next migration unit of tables[0]
+    std::atomic<bool> rehashing{false};
+    size_t count = 0;                 // number of keys stored
+    size_t minCapacity = 0;           // shrinking stops here
+    std::atomic<bool> shrinkWanted{false};
+
+    void startRehash(size_t newCapacity);
+    void finishRehash();
+    // capacity a sparse table should shrink to, 0 when it is not worth it
+    size_t shrinkTarget() const;
+    // called after every delete, only flags the shard for the idle tick
+    void noteErase();
+    // finds the entry in whichever table holds it, the table index is stored in tableOut
+    HashEntry* findEntry(std::string_view key, KeyHash hash, int* tableOut = nullptr);
+};
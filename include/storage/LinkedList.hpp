@@ -2,6 +2,7 @@
 #define LINKEDLIST_HPP
 
 #include <string>
+#include <string_view>
 #include <stdexcept>
 
 // ----------------- Node -----------------
@@ -11,7 +12,7 @@ public:
     ListNode* prev;
     ListNode* next;
 
-    ListNode(const std::string& val)
+    ListNode(std::string_view val)
         : value(val), prev(nullptr), next(nullptr) {}
 };
 
@@ -23,11 +24,14 @@ public:
     size_t size;
 
     LinkedList() : head(nullptr), tail(nullptr), size(0) {}
+    LinkedList(const LinkedList& other);       // deep copy, node by node
+    LinkedList(LinkedList&& other) noexcept;   // takes the nodes over
+    LinkedList& operator=(const LinkedList&) = delete;
     ~LinkedList();
 
     // Push/Pop operations
-    void push_front(const std::string& val);
-    void push_back(const std::string& val);
+    void push_front(std::string_view val);
+    void push_back(std::string_view val);
     std::string pop_front();
     std::string pop_back();
 
@@ -37,7 +41,7 @@ public:
 
     // Random access (O(n))
     std::string get(long long index) const;
-    void set(long long index, const std::string& val);
+    void set(long long index, std::string_view val);
 
     // Helpers
     bool empty() const { return size == 0; }
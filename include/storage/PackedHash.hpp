@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// a small HASH packed into one contiguous run of bytes, listpack style
+//
+// every field is stored as [field length][field][value length][value], one length byte each,
+// the fields one after the other. lookups scan it linearly, for a handful of short fields that
+// is cheaper than hashing and touches a cache line or two instead of a bucket array and a node
+// plus strings per field. a hash stays packed while it has at most maxFields fields and every
+// field and value is at most maxBytes long, RedisObject converts it to HashFields for good on
+// the first write past either limit
+class PackedHash {
+public:
+    // the limits, set once at startup before any hash exists
+    static inline size_t maxFields = 128;
+    static inline size_t maxBytes = 64;
+    static constexpr size_t BYTES_LIMIT = 255;   // a length has to fit its byte
+
+    static bool fits(std::string_view s) { return s.size() <= maxBytes; }
+
+    size_t size() const { return count; }
+    std::optional<std::string_view> get(std::string_view field) const;
+    bool contains(std::string_view field) const { return find(field) != NPOS; }
+    // adds or overwrites a field, true when it is new. both have to fit
+    bool set(std::string_view field, std::string_view value);
+    bool erase(std::string_view field);
+
+    // fn(field, value) for every field, in insertion order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t pos = 0; pos < buf.size();) {
+            Entry e = at(pos);
+            fn(e.field, e.value);
+            pos = e.end;
+        }
+    }
+
+private:
+    struct Entry {
+        std::string_view field;
+        std::string_view value;
+        size_t end;   // where the next field starts
+    };
+    static constexpr size_t NPOS = size_t(-1);
+
+    std::string buf;
+    uint32_t count = 0;
+
+    Entry at(size_t pos) const;
+    // offset of the field's entry, NPOS when missing
+    size_t find(std::string_view field) const;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "storage/HashEntry.hpp"
+#include "storage/RedisObject.hpp"
+
+// one key as the lock-free readers see it
+//
+// a STRING or HASH snapshot holds a copy of the table's RedisObject, which shares its payload
+// instead of copying the data. while the snapshot holds that reference the writer can not
+// change the payload in place, its next write clones it first (copy on write), so readers
+// always see a payload nobody writes to. publishing is a reference count increment, the old
+// snapshot and with it the old reference are dropped through epoch based reclamation.
+// a LIST or SET only keeps its type, EXISTS is all the lock-free path answers for them and
+// holding their payload would make every write to them clone the whole container
+struct ReadSnapshot {
+    std::string key;
+    KeyHash hash = 0;
+    RedisType type = RedisType::STRING;
+    RedisObject value{RedisType::INT};   // STRING or HASH value, shared with the table
+
+    ReadSnapshot() = default;
+    ReadSnapshot(std::string_view key, KeyHash hash, const RedisObject& value);
+};
+
+// lock-free lookup table over the snapshots of one shard (read optimized mode)
+//
+// open addressing with linear probing over an array of atomic snapshot pointers. readers walk
+// it without any lock inside an epoch::Guard. writers are serialized by the exclusive shard
+// lock: they swap a slot to a new snapshot (or to a tombstone on delete) and retire the old one
+// through epoch based reclamation. keys never move inside an array, when it fills up a bigger
+// one is built next to it and swapped in as a whole, the old array is retired the same way
+class ReadIndex {
+public:
+    explicit ReadIndex(size_t capacity = 16);
+    ~ReadIndex();
+    ReadIndex(const ReadIndex&) = delete;
+    ReadIndex& operator=(const ReadIndex&) = delete;
+
+    // readers, the result is valid until the caller's epoch guard ends
+    const ReadSnapshot* find(std::string_view key, KeyHash hash) const;
+
+    // writers, the caller holds the shard lock exclusively
+    void publish(ReadSnapshot* snap);   // takes ownership, replaces the key's old snapshot
+    void remove(std::string_view key, KeyHash hash);
+
+private:
+    struct Slots {
+        size_t mask;
+        std::atomic<ReadSnapshot*>* slot;
+
+        explicit Slots(size_t capacity);
+        ~Slots();
+    };
+
+    std::atomic<Slots*> current;
+    size_t live = 0;   // slots holding a snapshot
+    size_t used = 0;   // live slots plus tombstones, bounds the probe length
+
+    void grow();
+};
@@ -1,43 +1,175 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
 #include "RedisObject.hpp"
-#include "murmurhash/murmurhash3.hpp"
+#include "storage/hash/keyhash.hpp"
+#include "storage/HashEntry.hpp"
+#include "storage/KeyspaceShard.hpp"
 
-struct HashEntry {
-    std::string key;
-    RedisObject value;
+// the keyspace, split into a power of two number of hash partitions (shards)
+//
+// every shard has its own table, resize and reader-writer lock. the map itself never locks:
+// whoever runs a command takes a ShardGuard over the shards of all keys it touches first,
+// shared for reads and exclusive for writes
+class RedisHashMap {
+public:
+    static constexpr size_t MAX_SHARDS = 64;   // shard sets are passed around as a 64 bit mask
 
-    HashEntry(const std::string& k, const RedisObject& v)
-        : key(k), value(v) {}
-};
+    // size is the initial capacity of the whole keyspace, it is spread over the shards
+    RedisHashMap(size_t size = 1024, size_t shardCount = 16);
 
-class RedisHashMap {
-private:
-    std::vector<std::vector<HashEntry>> buckets;
-    size_t capacity;
+    // sizes the keyspace for this many keys up front so loading them causes no resizes, the
+    // tables also never shrink below it. the caller holds every shard exclusively, or calls it
+    // before the map is shared
+    void reserve(size_t keys);
 
-    size_t count = 0;                 // number of keys stored
-    const float loadFactor = 0.75f;   // resize threshold
+    // ---------- Key management ----------
+    // keys are taken as views so callers working on the network buffer never allocate for a lookup
+    bool add(std::string_view key, const RedisObject& value);
+    bool add(std::string_view key, RedisObject&& value);
+    bool del(std::string_view key);
+    bool exists(std::string_view key) const;
+    // rename and copy touch two keys, the caller must hold the shards of both
+    bool rename(std::string_view oldKey, std::string_view newKey);
+    bool copy(std::string_view sourceKey, std::string_view destKey);
 
-    size_t getIndex(const std::string& key) const;
+    // ---------- Value access ----------
+    // the pointer stays valid until the next write to the map, reads never move entries
+    RedisObject* get(std::string_view key);
 
-    // ----- Dynamic Resizing -----
-    void resize(size_t newCapacity);
+    // ---------- In place creation ----------
+    // for writes that create their value: the key is hashed once and looked up once, and the
+    // value is built straight into the new entry. the pointers follow the rules of get()
+    //
+    // the value of key, or a new one from make() when it is missing. make only runs for a new
+    // key, the bool is true when it did
+    template <typename Make>
+    std::pair<RedisObject*, bool> getOrCreate(std::string_view key, Make&& make);
+    // same, the new value is RedisObject(args...), e.g. tryEmplace(key, RedisType::HASH)
+    template <typename... Args>
+    std::pair<RedisObject*, bool> tryEmplace(std::string_view key, Args&&... args) {
+        return getOrCreate(key, [&] { return RedisObject(std::forward<Args>(args)...); });
+    }
+    // inserts or overwrites the value of key with RedisObject(args...)
+    template <typename... Args>
+    RedisObject* emplace(std::string_view key, Args&&... args);
 
-public:
-    RedisHashMap(size_t size = 1024); // default 1024 buckets
+    // ---------- Batched access ----------
+    // same results as one get/exists/del/add per key, but the keys are hashed and their buckets
+    // and entries prefetched PREFETCH_BATCH at a time before any of them is resolved, so the
+    // cache misses of a batch overlap instead of being paid one after the other.
+    // the caller holds the shards of all the keys, like for the single key calls
+    static constexpr size_t PREFETCH_BATCH = 16;
+    // values[i] is the value of keys[i] or nullptr, the pointers stay valid until the next write
+    void getMany(std::span<const std::string_view> keys, RedisObject** values);
+    size_t existsMany(std::span<const std::string_view> keys) const;   // a repeated key counts again
+    size_t delMany(std::span<const std::string_view> keys);
+    // keys and values interleaved, every value is stored as a string
+    void addMany(std::span<const std::string_view> pairs);
+    // cache hint only, it takes the shards of the keys shared just for the prefetch so it can run
+    // ahead of pipelined commands that lock on their own. lock is false when the map is private
+    // to the calling thread
+    void prefetch(std::span<const std::string_view> keys, bool lock = true);
 
-    // ---------- Key management ----------
-    bool add(const std::string& key, const RedisObject& value);
-    bool del(const std::string& key);
-    bool exists(const std::string& key) const;
-    bool rename(const std::string& oldKey, const std::string& newKey);
-    bool copy(const std::string& sourceKey, const std::string& destKey);
+    // ---------- Sharding ----------
+    size_t shardCount() const { return shards.size(); }
+    // bucket (or slot) count of all shards together, the caller holds every shard
+    size_t capacity() const;
+    size_t shardOf(std::string_view key) const { return shardFor(hashKey(key)); }
+    uint64_t shardMask(std::string_view key) const { return uint64_t(1) << shardOf(key); }
 
-    // ---------- Value access ----------
-    RedisObject* get(const std::string& key);
+    // locks every shard in the mask, always in ascending shard order so two commands
+    // over overlapping shard sets can never wait on each other in a cycle
+    class ShardGuard {
+    public:
+        ShardGuard(RedisHashMap& map, uint64_t mask, bool exclusive);
+        ~ShardGuard();
+        ShardGuard(const ShardGuard&) = delete;
+        ShardGuard& operator=(const ShardGuard&) = delete;
+
+    private:
+        RedisHashMap& map;
+        uint64_t mask;
+        bool exclusive;
+    };
+
+    // ---------- Incremental rehashing ----------
+    // true while a shard is resizing or waits for an idle tick to start shrinking
+    bool isRehashing() const;
+    // migrates buckets for about the given time, meant for idle ticks of the event loop
+    // shards that are busy are skipped, returns true while there is still work left
+    bool rehashFor(std::chrono::microseconds budget);
+
+    // ---------- Scanning ----------
+    // one SCAN call: copies keys out from the cursor on until about count were found, or
+    // count * 10 buckets were visited so a sparse keyspace can not turn one call into a full walk,
+    // and returns the cursor to continue from, 0 once every shard is done. a key that exists for
+    // the whole iteration is returned at least once even when tables resize in between, keys
+    // added or removed meanwhile may or may not be. shards are locked shared one at a time
+    // while they are walked, the caller holds none
+    //
+    // the cursor is the shard number above SCAN_SHARD_SHIFT and the shard's own bucket cursor
+    // (KeyspaceShard::scan) below it. it always stays under 2^SCAN_CURSOR_BITS, the bits above
+    // are left to the server
+    static constexpr unsigned SCAN_CURSOR_BITS = 52;
+    uint64_t scan(uint64_t cursor, size_t count, std::vector<std::string>& keys);
+
+    // ---------- Read optimized mode ----------
+    // every shard also keeps an immutable snapshot per key in a ReadIndex, lookups through
+    // snapshot() take no lock at all. writes still lock their shards and refresh the snapshots
+    // of the keys they touched with publish(). has to be turned on while the keyspace is empty
+    void enableReadIndex();
+    bool readOptimized() const { return readIndexed; }
+    // the caller must be inside an epoch::Guard, the snapshot lives until the guard ends
+    const ReadSnapshot* snapshot(std::string_view key) const;
+    // points the key's snapshot at the table's current value, sharing its payload. the caller
+    // holds the key's shard exclusively
+    void publish(std::string_view key);
+
+private:
+    std::vector<std::unique_ptr<KeyspaceShard>> shards;
+    unsigned shardBits = 0;
+    bool readIndexed = false;
+
+    static KeyHash hashKey(std::string_view key) { return keyhash::hash(key); }
+
+    static constexpr unsigned SCAN_SHARD_SHIFT = SCAN_CURSOR_BITS - 6;   // 6 bits for MAX_SHARDS
+    static_assert(MAX_SHARDS <= 64);
+
+    // runs fn(index, hash, shard) for keys[0], keys[stride], ... one prefetched batch at a time
+    template <typename Fn>
+    void forEachBatched(std::span<const std::string_view> keys, size_t stride, Fn&& fn) const;
+
+    // the tables index with the low hash bits, so the shard is picked from the top bits of a
+    // fibonacci remix of the hash to keep the two independent
+    size_t shardFor(KeyHash hash) const {
+        return shardBits ? (size_t)((hash * 0x9E3779B97F4A7C15ull) >> (64 - shardBits)) : 0;
+    }
+    KeyspaceShard& shard(KeyHash hash) { return *shards[shardFor(hash)]; }
 };
+
+template <typename Make>
+std::pair<RedisObject*, bool> RedisHashMap::getOrCreate(std::string_view key, Make&& make) {
+    KeyHash hash = hashKey(key);
+    KeyspaceShard& s = shard(hash);
+    if (HashEntry* entry = s.find(key, hash)) return { &entry->value, false };
+    return { &s.insertNew(key, make(), hash)->value, true };
+}
+
+template <typename... Args>
+RedisObject* RedisHashMap::emplace(std::string_view key, Args&&... args) {
+    KeyHash hash = hashKey(key);
+    KeyspaceShard& s = shard(hash);
+    if (HashEntry* entry = s.find(key, hash)) {
+        entry->value = RedisObject(std::forward<Args>(args)...);
+        return &entry->value;
+    }
+    return &s.insertNew(key, RedisObject(std::forward<Args>(args)...), hash)->value;
+}
@@ -1,22 +1,48 @@
 #ifndef REDIS_OBJECT_HPP
 #define REDIS_OBJECT_HPP
 
-#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
 #include <string>
-#include <vector>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include "storage/IntSet.hpp"
 #include "storage/LinkedList.hpp"
+#include "storage/PackedHash.hpp"
+#include "storage/hash/keyhash.hpp"
 
 // Forward declaration for recursive types
 class RedisObject;
 
-// Hash and equality for RedisObject (for sets)
-struct RedisObjectHash;
-struct RedisObjectEqual;
+// ---------- Hash and equality for RedisObject (for sets) ----------
+// defined ahead of the class, its inline accessors already need SetMembers complete
+struct RedisObjectHash {
+    std::size_t operator()(const RedisObject& obj) const;
+};
+
+struct RedisObjectEqual {
+    bool operator()(const RedisObject& a, const RedisObject& b) const;
+};
+
+// transparent string hash, lets maps keyed by std::string be searched with a string_view
+// without building a temporary string
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return (size_t)keyhash::hash(s); }
+};
+
+// fields of a HASH value
+using HashFields = std::unordered_map<std::string, RedisObject, StringViewHash, std::equal_to<>>;
+// members of a SET value
+using SetMembers = std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>;
 
 // Supported types
-enum class RedisType {
+enum class RedisType : uint8_t {
     INT,
     STRING,
     BOOL,
@@ -25,73 +51,222 @@ enum class RedisType {
     SET
 };
 
+// a value as a compact tagged union of 24 bytes
+//
+// integers, booleans and strings of up to INLINE_CAP bytes are stored inside the object itself,
+// so most small values cost no allocation and no pointer chase. only longer strings and the
+// containers live on the heap, behind a pointer kept in the same bytes. strings of up to
+// EMBED_CAP bytes and intsets take a single allocation there, sized to fit
+//
+// heap payloads are reference counted: copying a value shares its payload, and the first write
+// through a payload that is shared clones it (copy on write). COPY of a big set is one counter
+// increment. the count is atomic as two keys sharing a payload may sit in shards locked by
+// different threads, a payload with a count of one is only reachable through the value that
+// holds it and so is guarded by that value's shard lock
 class RedisObject {
-private:
-    RedisType type;
-    void* ptr;
-
-    // helper to free ptr and reset
-    void clearPtr();
-
-    // helper to clone pointer for copy constructor/assignment
-    void* clonePtr() const;
-
 public:
+    static constexpr size_t INLINE_CAP = 21;
+    static constexpr size_t EMBED_CAP = 44;
+
     // ---------- Constructors ----------
+    // an empty value of the type: 0, false, "" or an empty container, a HASH starts packed and
+    // a SET as an IntSet
+    explicit RedisObject(RedisType type);
     RedisObject(int value);
     RedisObject(const std::string& value);
+    RedisObject(std::string&& value);
+    explicit RedisObject(std::string_view value);
     RedisObject(bool value);
-    RedisObject(LinkedList* list);
-    RedisObject(const std::vector<RedisObject>& value);
-    RedisObject(const std::unordered_map<std::string, RedisObject>& value);
-    RedisObject(const std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>& value);
+    // containers are copied, or moved into the payload without copying their elements
+    RedisObject(LinkedList&& list);
+    RedisObject(const HashFields& value);
+    RedisObject(HashFields&& value);
+    RedisObject(const SetMembers& value);
+    RedisObject(SetMembers&& value);
+
+    // ---------- String encodings ----------
+    // a STRING value. one that reads as a 64 bit integer in canonical form ("42", not "042" or
+    // "+42") is kept as that number (INT encoding), so INCR and friends update it in place and
+    // it is only formatted when it is read
+    static RedisObject stringValue(std::string_view value);
+    static RedisObject stringValue(long long value);
 
     // ---------- Rule of five ----------
-    // Copy constructor (deep copy)
+    // copies share the heap part of the other object, see above
     RedisObject(const RedisObject& other);
-
-    // Copy assignment (deep copy)
     RedisObject& operator=(const RedisObject& other);
-
-    // Move constructor
     RedisObject(RedisObject&& other) noexcept;
-
-    // Move assignment
     RedisObject& operator=(RedisObject&& other) noexcept;
-
-    // ---------- Destructor ----------
     ~RedisObject();
 
-
     // ---------- Type Getter ----------
-    RedisType getType() const;
+    RedisType getType() const { return type; }
 
-    // ---------- getValue ----------
-    template<typename T>
-    T& getValue() const {
-        return *static_cast<T*>(ptr);
-    }
+    // ---------- Scalars ----------
+    long long getInt() const { return load<int64_t>(); }   // INT, or a STRING in the INT encoding
+    bool getBool() const { return load<int64_t>() != 0; }  // BOOL
 
-        // ---------- Pointer Getter ----------
-    void* getPtr() const {
-        return ptr;
+    // ---------- Strings ----------
+    // an INT encoded string has no bytes to look at, check intEncoded() before calling str()
+    bool intEncoded() const { return encoding == Encoding::INT; }
+    // the bytes of a STRING value, valid until the value changes
+    std::string_view str() const {
+        if (encoding == Encoding::INLINE) return std::string_view(data, len);
+        if (encoding == Encoding::EMBEDDED) {
+            auto* e = static_cast<const Embedded*>(header());
+            return std::string_view(e->bytes(), e->size);
+        }
+        return payload<std::string>();
     }
+    // the value formatted as a new string, for the few readers that need a copy anyway
+    std::string toString() const;
+    size_t strSize() const;
+    // a string that outgrows INLINE_CAP moves to the heap, it never moves back. an embedded
+    // string is read only, appending to it builds a new one or, past EMBED_CAP, a std::string
+    // that later appends grow in place. an INT encoded string is turned back into bytes first
+    void append(std::string_view s);
+    // stores the number in the INT encoding, whatever the string held before
+    void setInt(long long value);
+
+    // ---------- Hashes ----------
+    // a HASH is a PackedHash while it is small and HashFields once it outgrew the packed limits,
+    // these work on either and do the conversion
+    bool packedHash() const { return encoding == Encoding::PACKED; }
+    size_t hashSize() const;
+    std::optional<std::string_view> hashGet(std::string_view field) const;
+    // true when the field is new
+    bool hashSet(std::string_view field, std::string_view value);
+    bool hashDel(std::string_view field);
+    // fn(field, value) for every field
+    template <typename Fn>
+    void forEachField(Fn&& fn) const;
+
+    // ---------- Sets ----------
+    // a SET is an IntSet while its members are all integers and few, SetMembers otherwise.
+    // these work on either and do the conversion
+    bool intSet() const { return encoding == Encoding::INTSET; }
+    size_t setSize() const;
+    // member is a STRING, in the INT encoding or not
+    bool setContains(const RedisObject& member) const;
+    bool setContains(std::string_view member) const;
+    // true when the member was added, or removed
+    bool setAdd(std::string_view member);
+    bool setRemove(std::string_view member);
+    // fn(member) for every member, intset members are handed out as INT encoded temporaries
+    template <typename Fn>
+    void forEachMember(Fn&& fn) const;
+
+    // ---------- Containers ----------
+    // read access to the container of a LIST, HASH or SET value, hash()/packed() and
+    // set()/ints() only for the matching encoding of a HASH or SET
+    const LinkedList* list() const { return &payload<LinkedList>(); }
+    const HashFields* hash() const { return &payload<HashFields>(); }
+    const PackedHash* packed() const { return &payload<PackedHash>(); }
+    const SetMembers* set() const { return &payload<SetMembers>(); }
+    const IntSet* ints() const { return static_cast<const SharedInts*>(header()); }
+    // write access, a container other values share is cloned first so theirs stays as it is
+    LinkedList* mutableList() { return &ownPayload<LinkedList>(); }
+    HashFields* mutableHash() { return &ownPayload<HashFields>(); }
+    SetMembers* mutableSet() { return &ownPayload<SetMembers>(); }
+    IntSet* mutableInts();
 
     // ---------- Equality operator ----------
+    // strings and scalars compare by value, containers by identity
     bool operator==(const RedisObject& other) const;
 
-    // Allow hash functions to access private ptr
-    friend struct RedisObjectHash;
-    friend struct RedisObjectEqual;
-};
+private:
+    // where the value lives, the type alone does not say it for strings
+    enum class Encoding : uint8_t {
+        INLINE,   // in data: the integer, the bool or len string bytes
+        INT,      // a STRING whose bytes are an integer, data holds the number
+        EMBEDDED, // data holds a SharedHeader* to an Embedded string
+        PACKED,   // a HASH, data holds a SharedHeader* to a PackedHash
+        INTSET,   // a SET, data holds a SharedHeader* to a SharedInts block
+        HEAP      // data holds a SharedHeader* to a std::string or a container
+    };
 
-// ---------- Hash and equality for RedisObject (for sets) ----------
-struct RedisObjectHash {
-    std::size_t operator()(const RedisObject& obj) const;
-};
+    // every heap payload starts with its reference count
+    struct SharedHeader {
+        std::atomic<uint32_t> refs{1};
+    };
+    template <typename T>
+    struct Shared : SharedHeader {
+        T value;
+        template <typename... Args>
+        explicit Shared(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+    // a string of up to EMBED_CAP bytes: count, length and bytes in one block, the bytes right
+    // behind the header. one allocation instead of two, and a read touches a single cache line
+    struct Embedded : SharedHeader {
+        uint32_t size = 0;
+        const char* bytes() const { return reinterpret_cast<const char*>(this + 1); }
+        char* bytes() { return reinterpret_cast<char*>(this + 1); }
+    };
+    // an intset block: count, then the IntSet head and its members, again a single allocation
+    struct SharedInts : SharedHeader, IntSet {
+        SharedInts(uint8_t width, uint32_t capacity) : IntSet(width, capacity) {}
+    };
+    static_assert(sizeof(SharedInts) == sizeof(SharedHeader) + sizeof(IntSet) &&
+                  sizeof(SharedInts) % alignof(int64_t) == 0,
+                  "the members of an intset start right behind the block head, 8 byte aligned");
 
-struct RedisObjectEqual {
-    bool operator()(const RedisObject& a, const RedisObject& b) const;
+    alignas(8) char data[INLINE_CAP];
+    uint8_t len = 0;                 // bytes of an inline string
+    Encoding encoding = Encoding::INLINE;
+    RedisType type;
+
+    // data is raw bytes, integers and pointers are copied in and out so they need no alignment
+    // or aliasing guarantees beyond the ones of char
+    template <typename T>
+    T load() const {
+        T v;
+        std::memcpy(&v, data, sizeof v);
+        return v;
+    }
+    template <typename T>
+    void store(T v) { std::memcpy(data, &v, sizeof v); }
+
+    SharedHeader* header() const { return load<SharedHeader*>(); }
+    bool onHeap() const { return encoding >= Encoding::EMBEDDED; }
+    template <typename T>
+    T& payload() const { return static_cast<Shared<T>*>(header())->value; }
+    template <typename T, typename... Args>
+    void makePayload(Args&&... args) {
+        store<SharedHeader*>(new Shared<T>(std::forward<Args>(args)...));
+        encoding = Encoding::HEAP;
+    }
+    // the payload for writing, cloned first when it is shared
+    template <typename T>
+    T& ownPayload();
+
+    void setString(std::string_view s);
+    void setEmbedded(std::string_view s);
+    // replaces the intset by a new block of the given shape holding the same members
+    IntSet& reshapeInts(uint8_t width, size_t capacity);
+    // the intset for writing with room for v, a shared or full one is replaced first
+    IntSet& intsFor(int64_t v);
+    // moves the fields of a packed hash into a HashFields
+    void unpackHash();
+    // moves the members of an intset into a SetMembers
+    void unpackSet();
+    void takeFrom(RedisObject& other);
+    void copyFrom(const RedisObject& other);
+    // drops the reference to the heap part, if there is one, the last one frees it
+    void release();
 };
 
+static_assert(sizeof(RedisObject) == 24, "RedisObject is meant to stay three words");
+
+template <typename Fn>
+void RedisObject::forEachField(Fn&& fn) const {
+    if (packedHash()) return packed()->forEach(fn);
+    for (auto& [field, value] : *hash()) fn(std::string_view(field), value.str());
+}
+
+template <typename Fn>
+void RedisObject::forEachMember(Fn&& fn) const {
+    if (intSet()) return ints()->forEach([&](int64_t v) { fn(stringValue((long long)v)); });
+    for (const RedisObject& member : *set()) fn(member);
+}
+
 #endif // REDIS_OBJECT_HPP
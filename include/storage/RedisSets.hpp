@@ -3,24 +3,29 @@
 
 #include "RedisHashMap.hpp"
 #include "RedisObject.hpp"
+#include "parser/reply.hpp"
 #include <string>
 #include <unordered_set>
 #include <vector>
+#include <string_view>
+#include <span>
 
 namespace setstore {
 
     // ---------------- Basic Set Commands ----------------
-    std::string sadd(RedisHashMap& map, const std::string& key, const std::string& value);
-    std::string srem(RedisHashMap& map, const std::string& key, const std::string& value);
-    std::string smembers(RedisHashMap& map, const std::string& key);
-    std::string scard(RedisHashMap& map, const std::string& key);
-    std::string spop(RedisHashMap& map, const std::string& key);
-    std::string sismember(RedisHashMap& map, const std::string& key, const std::string& value);
+    void sadd(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out);
+    void srem(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out);
+    void smembers(RedisHashMap& map, std::string_view key, ReplyWriter& out);
+    void scard(RedisHashMap& map, std::string_view key, ReplyWriter& out);
+    void spop(RedisHashMap& map, std::string_view key, ReplyWriter& out);
+    void sismember(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out);
+    // args start at the cursor: cursor [MATCH pattern] [COUNT count]
+    void sscan(RedisHashMap& map, std::string_view key, std::span<const std::string_view> args, ReplyWriter& out);
 
     // ---------------- Set Operations ----------------
-    std::string sunion(RedisHashMap& map, const std::string& key1, const std::string& key2);
-    std::string sinter(RedisHashMap& map, const std::string& key1, const std::string& key2);
-    std::string sdiff(RedisHashMap& map, const std::string& key1, const std::string& key2);
+    void sunion(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out);
+    void sinter(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out);
+    void sdiff(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out);
 
 }
 
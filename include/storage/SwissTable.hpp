@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "storage/HashEntry.hpp"
+
+// open addressing engine for RedisHashMap in the style of a swiss table
+//
+// entries live in one flat slot array next to an array of control bytes, one per slot. a control
+// byte is either EMPTY, DELETED or the low 7 bits of the key hash (the tag). a lookup picks a group
+// of 16 slots from the upper hash bits and compares all 16 control bytes against the tag at once
+// (one sse2 compare), so the key itself is only compared for slots whose tag matches
+//
+// same interface as ChainedTable, a migration unit is one group of 16 slots
+class SwissTable {
+public:
+    static constexpr size_t GROUP = 16;
+
+    // capacity is rounded up to a power of two of at least one group
+    explicit SwissTable(size_t capacity = 0);
+    ~SwissTable();
+
+    SwissTable(SwissTable&& other) noexcept;
+    SwissTable& operator=(SwissTable&& other) noexcept;
+    SwissTable(const SwissTable&) = delete;
+    SwissTable& operator=(const SwissTable&) = delete;
+
+    size_t capacity() const { return slotCount; }
+    size_t size() const { return count; }
+
+    HashEntry* find(std::string_view key, KeyHash hash);
+    // the key must not be present yet
+    HashEntry* insert(std::string_view key, RedisObject&& value, KeyHash hash);
+    bool erase(std::string_view key, KeyHash hash);
+
+    // batched lookups touch the control bytes of the home group first and the slots whose tag
+    // matches second, each stage is prefetched for the whole batch before the next one runs
+    void prefetchBucket(KeyHash hash) const;
+    void prefetchEntries(KeyHash hash) const;
+
+    // ---------- resizing ----------
+    // tombstones count against the 7/8 load limit, every probe must still end on an EMPTY slot
+    bool overloaded() const { return count + tombstones > slotCount / 8 * 7; }
+    // a table that filled up mostly with tombstones is rebuilt at the same size
+    size_t grownCapacity() const { return count > slotCount / 16 * 7 ? slotCount * 2 : slotCount; }
+    bool underloaded() const { return count * 10 < slotCount; }   // load factor below 0.1
+    // smallest slot count that holds keys below the load limit
+    static size_t capacityFor(size_t keys) {
+        size_t n = GROUP;
+        while (keys > n / 8 * 7) n <<= 1;
+        return n;
+    }
+    size_t migrationUnits() const { return slotCount / GROUP; }
+    // moves every entry of one group into dest, returns the number of entries moved
+    size_t migrate(size_t unit, SwissTable& dest);
+
+    // ---------- scanning ----------
+    // SCAN walks the table by home group (see ChainedTable), a key pushed further along its
+    // probe sequence is still reported with the group it hashes to
+    size_t scanUnits() const { return groupMask + 1; }
+    void scanUnit(size_t unit, std::vector<const HashEntry*>& out) const;
+
+private:
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+
+    int8_t* ctrl = nullptr;
+    HashEntry* slots = nullptr;
+    size_t slotCount = 0;
+    size_t groupMask = 0;     // number of groups - 1
+    size_t count = 0;
+    size_t tombstones = 0;
+
+    static size_t homeGroup(KeyHash hash) { return hash >> 7; }
+    static int8_t tag(KeyHash hash) { return (int8_t)(hash & 0x7F); }
+
+    // bit i of the result is set when control byte i of the group matches
+    static uint32_t matchTag(const int8_t* group, int8_t t);
+    static uint32_t matchEmpty(const int8_t* group);
+    static uint32_t matchFree(const int8_t* group);   // EMPTY or DELETED
+
+    size_t findSlot(std::string_view key, KeyHash hash) const;   // slotCount when absent
+    size_t freeSlot(KeyHash hash) const;
+    void release();
+};
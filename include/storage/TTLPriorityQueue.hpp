@@ -3,13 +3,14 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
-#include "storage\RedisHashMap.hpp"
+#include "storage/RedisHashMap.hpp"
 
 /*
  * TTLPriorityQueue
@@ -20,7 +21,9 @@
  *  - get remaining TTL for a key
  *  - background thread (10s wake) that removes expired keys and calls db->del(key)
  *
- * NOTE: This class is thread-safe for its public methods.
+ * NOTE: This class is thread-safe for its public methods. A queue created without a worker
+ * belongs to the thread that owns its keyspace: it takes no locks and that thread expires the
+ * keys itself through expireDue().
  */
 
 struct ttlObject {
@@ -30,7 +33,7 @@ struct ttlObject {
 
 class TTLPriorityQueue {
 public:
-    explicit TTLPriorityQueue(RedisHashMap* db = nullptr);
+    explicit TTLPriorityQueue(RedisHashMap* db = nullptr, bool threaded = true);
     ~TTLPriorityQueue();
 
     // Start worker (if not started). db pointer is required for expiration deletes.
@@ -41,22 +44,26 @@ public:
 
     // Insert or update TTL for key (seconds from now). If seconds <= 0, treat as immediate expiration.
     // Returns true if inserted/updated; false if key didn't exist in DB (and no action taken).
-    bool insertOrUpdate(const std::string& key, long long seconds);
+    bool insertOrUpdate(std::string_view key, long long seconds);
 
     // Remove TTL entry for key if present. Does NOT delete key from DB.
     // Returns true if removed from the TTL queue, false if not found.
-    bool remove(const std::string& key);
+    bool remove(std::string_view key);
 
     // Query remaining TTL in seconds.
     // Returns:
     //  >=0 : seconds remaining
     //  -1  : key exists in DB but no TTL associated
     //  -2  : key does not exist in DB
-    long long getTTLSeconds(const std::string& key) const;
+    long long getTTLSeconds(std::string_view key) const;
 
     // Size of the heap
     size_t size() const;
 
+    // Queues without a worker only: deletes up to budget keys whose ttl ran out and returns the
+    // milliseconds until the next one does, 0 when due keys are left over and -1 when none wait.
+    int expireDue(size_t budget);
+
 private:
     // Heap helpers
     void heapifyUp(size_t idx);
@@ -72,12 +79,18 @@ private:
     // Worker thread function
     void workerLoop();
 
+    // holds mu for queues shared with a worker, an empty lock for thread private ones
+    std::unique_lock<std::mutex> lockHeap() const {
+        return threaded ? std::unique_lock<std::mutex>(mu) : std::unique_lock<std::mutex>();
+    }
+
 private:
     mutable std::mutex mu;
     std::vector<ttlObject> heap;
-    std::unordered_map<std::string, size_t> indexMap; // key -> index in heap
+    std::unordered_map<std::string, size_t, StringViewHash, std::equal_to<>> indexMap; // key -> index in heap
 
     RedisHashMap* dbPtr; // not owned
+    bool threaded;       // false: no worker, only the keyspace's own thread uses the queue
     std::thread worker;
     std::atomic<bool> running;
     std::condition_variable cv;
@@ -90,7 +103,8 @@ private:
     }
 };
 
-// Global accessor - create on demand. Implementation in TTLPriorityQueue.cpp
-TTLPriorityQueue* getGlobalTTL(RedisHashMap* db = nullptr);
+// Global accessor - create on demand, one queue per keyspace. Implementation in TTLPriorityQueue.cpp
+// the first call for a keyspace decides whether its queue gets a worker thread
+TTLPriorityQueue* getGlobalTTL(RedisHashMap* db = nullptr, bool worker = true);
 
 #endif // TTL_PRIORITY_QUEUE_HPP
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// key hashing, one place for everything that hashes user data: the keyspace tables, the shard
+// and core a key belongs to, and the field / member maps of hashes and sets
+//
+// the default is a 64 bit hash in the style of wyhash, it reads 16 bytes per round (three 16
+// byte lanes for keys over 48 bytes) and mixes them with 64x64->128 bit multiplies.
+// -DKEYSPACE_HASH=murmur3 builds with MurmurHash3_x86_32 instead, zero extended to 64 bits.
+// both are seeded with a random value picked once per process, so which keys collide cannot
+// be worked out from the outside. HASH_SEED=<number> pins the seed when runs must be repeatable
+namespace keyhash {
+
+uint64_t wyhash(const void* data, size_t len, uint64_t seed);
+uint64_t murmur3(const void* data, size_t len, uint64_t seed);
+
+// reads HASH_SEED or the random device, only called once
+uint64_t pickSeed();
+
+// fixed for the lifetime of the process, initialized on first use so hashing from static
+// initializers is safe too
+inline uint64_t seed() {
+    static const uint64_t value = pickSeed();
+    return value;
+}
+
+inline uint64_t hash(std::string_view s) {
+#ifdef KEYSPACE_HASH_MURMUR3
+    return murmur3(s.data(), s.size(), seed());
+#else
+    return wyhash(s.data(), s.size(), seed());
+#endif
+}
+
+} // namespace keyhash
@@ -3,32 +3,43 @@
 
 #include <string>
 #include <unordered_map>
+#include <string_view>
+#include <span>
 #include "storage/RedisHashMap.hpp"
 #include "storage/RedisObject.hpp"
+#include "parser/reply.hpp"
 
 namespace hashmapstore {
 
     // Set field in hash
-    std::string hset(RedisHashMap& map, const std::string& key,
-                     const std::string& field, const std::string& value);
+    void hset(RedisHashMap& map, std::string_view key,
+              std::string_view field, std::string_view value, ReplyWriter& out);
 
     // Get field from hash
-    std::string hget(RedisHashMap& map, const std::string& key,
-                     const std::string& field);
+    void hget(RedisHashMap& map, std::string_view key,
+              std::string_view field, ReplyWriter& out);
 
     // Delete field(s) from hash
-    std::string hdel(RedisHashMap& map, const std::string& key,
-                     const std::vector<std::string>& fields);
+    void hdel(RedisHashMap& map, std::string_view key,
+              std::span<const std::string_view> fields, ReplyWriter& out);
 
     // Get all fields and values
-    std::string hgetall(RedisHashMap& map, const std::string& key);
+    void hgetall(RedisHashMap& map, std::string_view key, ReplyWriter& out);
 
     // Check if field exists
-    std::string hexists(RedisHashMap& map, const std::string& key,
-                        const std::string& field);
+    void hexists(RedisHashMap& map, std::string_view key,
+                 std::string_view field, ReplyWriter& out);
 
     // Get number of fields
-    std::string hlen(RedisHashMap& map, const std::string& key);
+    void hlen(RedisHashMap& map, std::string_view key, ReplyWriter& out);
+
+    // Iterate fields and values, args start at the cursor: cursor [MATCH pattern] [COUNT count]
+    void hscan(RedisHashMap& map, std::string_view key,
+               std::span<const std::string_view> args, ReplyWriter& out);
+
+    // Lock-free HGET for read optimized mode, runs inside an epoch::Guard
+    void hgetSnapshot(const RedisHashMap& map, std::string_view key,
+                      std::string_view field, ReplyWriter& out);
 
 }
 
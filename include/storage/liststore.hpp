@@ -3,38 +3,40 @@
 
 #include <string>
 #include <stdexcept>
+#include <string_view>
 #include "storage/RedisHashMap.hpp"
 #include "storage/RedisObject.hpp"
+#include "parser/reply.hpp"
 #include "LinkedList.hpp"   // include your custom linked list
 
 namespace liststore {
 
     // Push value to the left (head)
-    std::string lpush(RedisHashMap& map, const std::string& key, const std::string& value);
+    void lpush(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out);
 
     // Push value to the right (tail)
-    std::string rpush(RedisHashMap& map, const std::string& key, const std::string& value);
+    void rpush(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out);
 
     // Pop value from the left (head)
-    std::string lpop(RedisHashMap& map, const std::string& key);
+    void lpop(RedisHashMap& map, std::string_view key, ReplyWriter& out);
 
     // Pop value from the right (tail)
-    std::string rpop(RedisHashMap& map, const std::string& key);
+    void rpop(RedisHashMap& map, std::string_view key, ReplyWriter& out);
 
     // Return list length
-    std::string llen(RedisHashMap& map, const std::string& key);
+    void llen(RedisHashMap& map, std::string_view key, ReplyWriter& out);
 
     // Return element at index
-    std::string lindex(RedisHashMap& map, const std::string& key, const std::string& indexStr);
+    void lindex(RedisHashMap& map, std::string_view key, std::string_view indexStr, ReplyWriter& out);
 
     // Set element at index
-    std::string lset(RedisHashMap& map, const std::string& key, const std::string& indexStr, const std::string& value);
+    void lset(RedisHashMap& map, std::string_view key, std::string_view indexStr, std::string_view value, ReplyWriter& out);
 
     // Sort list: 1 = ascending, 2 = descending
-    std::string lsort(RedisHashMap& map, const std::string& key, const std::string& orderStr);
+    void lsort(RedisHashMap& map, std::string_view key, std::string_view orderStr, ReplyWriter& out);
 
     // Print entire list
-    std::string lprint(RedisHashMap& map, const std::string& key);
+    void lprint(RedisHashMap& map, std::string_view key, ReplyWriter& out);
 
 
 }
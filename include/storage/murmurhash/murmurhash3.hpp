@@ -3,10 +3,11 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 uint32_t MurmurHash3_x86_32(const void* key, int len, uint32_t seed = 0);
 
-// Convenience overload for std::string
-uint32_t MurmurHash3_x86_32(const std::string& str, uint32_t seed = 0);
+// Convenience overload for std::string and string views
+uint32_t MurmurHash3_x86_32(std::string_view str, uint32_t seed = 0);
 
 #endif // MURMURHASH3_HPP
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser/reply.hpp"
+
+// pieces shared by SCAN, HSCAN and SSCAN
+namespace scanner {
+
+    struct Options {
+        uint64_t cursor = 0;
+        size_t count = 10;           // a hint for the work per call, like in redis
+        std::string_view pattern;    // MATCH pattern, empty when there is none
+    };
+
+    // parses "cursor [MATCH pattern] [COUNT count]", replies with the error and returns false
+    // when the arguments are malformed
+    bool parseOptions(std::span<const std::string_view> args, Options& opts, ReplyWriter& out);
+
+    // redis glob matching: * ? [abc] [^a-z] and backslash escapes
+    bool globMatch(std::string_view pattern, std::string_view s);
+
+    // the two element SCAN reply: the next cursor and the items whose name matches the pattern.
+    // items come in groups of stride (field, value for HSCAN), only the first of a group is matched
+    void reply(ReplyWriter& out, uint64_t cursor, const std::vector<std::string>& items,
+               std::string_view pattern, size_t stride = 1);
+
+    // HSCAN and SSCAN walk the buckets of the std::unordered_ container a value is stored in.
+    // its bucket count is not a power of two, so a reverse binary cursor does not carry over a
+    // rehash: the cursor keeps the bucket count in its top half instead and a walk whose
+    // container rehashed since the last call starts over. SCAN allows repeats but not misses, and
+    // as these containers only rehash when they grow that happens a few times at most
+    template <typename Container, typename Fn>
+    uint64_t walkBuckets(const Container& c, uint64_t cursor, size_t count, Fn&& emit) {
+        size_t buckets = c.bucket_count();
+        size_t b = (size_t)(cursor & 0xFFFFFFFFu);
+        if ((cursor >> 32) != (buckets & 0xFFFFFFFFu)) b = 0;
+
+        size_t found = 0;
+        size_t visits = (count ? count : 1) * 10;
+        for (; b < buckets && found < count && visits > 0; b++, visits--) {
+            for (auto it = c.begin(b); it != c.end(b); ++it, found++) emit(*it);
+        }
+        return b < buckets ? (uint64_t)(buckets & 0xFFFFFFFFu) << 32 | b : 0;
+    }
+
+}
@@ -3,34 +3,46 @@
 
 #include <string>
 #include <vector>
+#include <string_view>
+#include <span>
 #include "storage/RedisHashMap.hpp"
 #include "storage/RedisObject.hpp"
+#include "parser/reply.hpp"
 
 namespace stringstore {
 
     // Basic string commands
-    std::string set(RedisHashMap& db, const std::string& key, const std::string& value);
-    std::string get(RedisHashMap& db, const std::string& key);
-    std::string del(RedisHashMap& db, const std::string& key);
-    std::string exists(RedisHashMap& db, const std::string& key);
-    std::string rename(RedisHashMap& db, const std::string& oldKey, const std::string& newKey);
-    std::string copy(RedisHashMap& db, const std::string& sourceKey, const std::string& destKey);
+    void set(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out);
+    void get(RedisHashMap& db, std::string_view key, ReplyWriter& out);
+    // multi key DEL/EXISTS reply with the number of keys deleted / found
+    void del(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out);
+    void exists(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out);
+    void rename(RedisHashMap& db, std::string_view oldKey, std::string_view newKey, ReplyWriter& out);
+    void copy(RedisHashMap& db, std::string_view sourceKey, std::string_view destKey, ReplyWriter& out);
+    // SCAN cursor [MATCH pattern] [COUNT count], args start at the cursor
+    void scan(RedisHashMap& db, std::span<const std::string_view> args, ReplyWriter& out);
 
     // Extended string commands
-    std::string setnx(RedisHashMap& db, const std::string& key, const std::string& value);
-    std::string mset(RedisHashMap& db, const std::vector<std::string>& kvs);
-    std::string mget(RedisHashMap& db, const std::vector<std::string>& keys);
-    std::string append(RedisHashMap& db, const std::string& key, const std::string& value);
-    std::string strlen_(RedisHashMap& db, const std::string& key);
+    void setnx(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out);
+    void mset(RedisHashMap& db, std::span<const std::string_view> kvs, ReplyWriter& out);
+    void mget(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out);
+    void append(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out);
+    void strlen_(RedisHashMap& db, std::string_view key, ReplyWriter& out);
 
     // Increment / Decrement commands
-    std::string incr(RedisHashMap& db, const std::string& key);
-    std::string incrby(RedisHashMap& db, const std::string& key, const std::string& amount);
-    std::string decr(RedisHashMap& db, const std::string& key);
-    std::string decrby(RedisHashMap& db, const std::string& key, const std::string& amount);
+    void incr(RedisHashMap& db, std::string_view key, ReplyWriter& out);
+    void incrby(RedisHashMap& db, std::string_view key, std::string_view amount, ReplyWriter& out);
+    void decr(RedisHashMap& db, std::string_view key, ReplyWriter& out);
+    void decrby(RedisHashMap& db, std::string_view key, std::string_view amount, ReplyWriter& out);
+    void incrbyfloat(RedisHashMap& db, std::string_view key, std::string_view amount, ReplyWriter& out);
+
+    // Lock-free readers for read optimized mode, they run inside an epoch::Guard
+    void getSnapshot(const RedisHashMap& db, std::string_view key, ReplyWriter& out);
+    void existsSnapshot(const RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out);
+    void strlenSnapshot(const RedisHashMap& db, std::string_view key, ReplyWriter& out);
 
     // Expire stub
-    std::string expire(RedisHashMap& db, const std::string& key, const std::string& seconds);
+    void expire(RedisHashMap& db, std::string_view key, std::string_view seconds, ReplyWriter& out);
 
 } // namespace stringstore
 
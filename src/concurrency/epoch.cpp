@@ -0,0 +1,139 @@
+#include "concurrency/epoch.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace epoch {
+
+namespace {
+
+constexpr uint64_t INACTIVE = UINT64_MAX;
+// a thread tries to reclaim after this many retires
+constexpr size_t COLLECT_EVERY = 64;
+
+struct Retired {
+    uint64_t epoch;
+    void* ptr;
+    void (*deleter)(void*);
+};
+
+// one per thread, kept in a push only list so readers never need a lock to register.
+// records of finished threads are released and picked up again by new threads
+struct alignas(64) Record {
+    std::atomic<uint64_t> epoch{INACTIVE};
+    std::atomic<bool> inUse{true};
+    Record* next = nullptr;
+    unsigned depth = 0;   // nested guards on this thread, only the owner touches it
+};
+
+std::atomic<uint64_t> globalEpoch{0};
+std::atomic<Record*> records{nullptr};
+std::atomic<uint64_t> pendingCount{0};
+
+// garbage of threads that exited before it was safe to free, reclaimed by whoever collects next
+std::mutex orphanMu;
+std::vector<Retired> orphans;
+
+Record* acquireRecord() {
+    for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->inUse.load(std::memory_order_relaxed) &&
+            r->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return r;
+    }
+    Record* r = new Record();
+    Record* head = records.load(std::memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!records.compare_exchange_weak(head, r, std::memory_order_release,
+                                            std::memory_order_relaxed));
+    return r;
+}
+
+// the epoch moves forward only when every thread inside a guard has observed the current one
+bool tryAdvance() {
+    uint64_t e = globalEpoch.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t local = r->epoch.load(std::memory_order_acquire);
+        if (local != INACTIVE && local != e) return false;
+    }
+    return globalEpoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+}
+
+// frees every entry that is at least two epochs old, keeps the rest
+void reclaim(std::vector<Retired>& list) {
+    uint64_t e = globalEpoch.load(std::memory_order_acquire);
+    size_t kept = 0;
+    for (auto& item : list) {
+        if (item.epoch + 2 <= e) {
+            item.deleter(item.ptr);
+            pendingCount.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            list[kept++] = item;
+        }
+    }
+    list.resize(kept);
+}
+
+struct ThreadState {
+    Record* record = acquireRecord();
+    std::vector<Retired> limbo;
+    size_t sinceCollect = 0;
+
+    ~ThreadState() {
+        record->epoch.store(INACTIVE, std::memory_order_release);
+        record->inUse.store(false, std::memory_order_release);
+        if (limbo.empty()) return;
+        std::lock_guard<std::mutex> lock(orphanMu);
+        orphans.insert(orphans.end(), limbo.begin(), limbo.end());
+    }
+};
+
+ThreadState& self() {
+    thread_local ThreadState state;
+    return state;
+}
+
+} // namespace
+
+Guard::Guard() {
+    Record* r = self().record;
+    if (r->depth++ > 0) return;
+    r->epoch.store(globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // the announcement must be visible before any shared pointer is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+Guard::~Guard() {
+    Record* r = self().record;
+    if (--r->depth > 0) return;
+    r->epoch.store(INACTIVE, std::memory_order_release);
+}
+
+void retire(void* p, void (*deleter)(void*)) {
+    ThreadState& t = self();
+    t.limbo.push_back({ globalEpoch.load(std::memory_order_acquire), p, deleter });
+    pendingCount.fetch_add(1, std::memory_order_relaxed);
+    if (++t.sinceCollect >= COLLECT_EVERY) {
+        t.sinceCollect = 0;
+        collect();
+    }
+}
+
+void collect() {
+    ThreadState& t = self();
+    // a thread inside a guard would block its own progress, it collects later
+    if (t.record->depth > 0) return;
+    tryAdvance();
+    reclaim(t.limbo);
+
+    std::unique_lock<std::mutex> lock(orphanMu, std::try_to_lock);
+    if (lock.owns_lock() && !orphans.empty()) reclaim(orphans);
+}
+
+uint64_t pending() {
+    return pendingCount.load(std::memory_order_relaxed);
+}
+
+} // namespace epoch
@@ -0,0 +1,198 @@
+#include "logging/logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+namespace logging {
+
+std::atomic<int> runtimeLevel{(int)Level::Info};
+
+namespace {
+
+constexpr size_t RING_MASK = RING_SIZE - 1;
+static_assert((RING_SIZE & RING_MASK) == 0, "RING_SIZE must be a power of two");
+
+// bounded multi producer / single consumer ring (vyukov style)
+// every slot carries a sequence number: a producer may fill slot i at ticket pos when the
+// sequence equals pos, it publishes pos + 1, and the writer frees it again with pos + RING_SIZE.
+// sequences are stored relative to the slot index so the zero initialized ring is already in
+// its starting state and logging works even from static constructors
+Record ring[RING_SIZE];
+std::atomic<size_t> enqueuePos{0};
+std::atomic<uint64_t> dropped{0};
+
+size_t loadSequence(size_t idx) { return ring[idx].sequence.load(std::memory_order_acquire) + idx; }
+void storeSequence(size_t idx, size_t seq) { ring[idx].sequence.store(seq - idx, std::memory_order_release); }
+
+const char* levelName(Level lvl) {
+    switch (lvl) {
+        case Level::Debug: return "DEBUG";
+        case Level::Info:  return "INFO";
+        case Level::Warn:  return "WARN";
+        case Level::Error: return "ERROR";
+        default:           return "LOG";
+    }
+}
+
+// background writer, only this thread ever reads the ring or touches the clock cache
+struct Writer {
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::mutex lifecycle;         // serializes init() and shutdown()
+    size_t readPos = 0;
+    uint64_t reportedDrops = 0;
+
+    // coarse clock, the formatted stamp is rebuilt at most once per second
+    std::time_t stampSecond = 0;
+    char stamp[32] = {0};
+    size_t stampLen = 0;
+
+    std::string batch;
+
+    void refreshClock() {
+        std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        if (now == stampSecond && stampLen) return;
+        stampSecond = now;
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &now);
+#else
+        localtime_r(&now, &tm);
+#endif
+        stampLen = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+
+    void appendLine(Level lvl, std::string_view text) {
+        batch += '[';
+        batch.append(stamp, stampLen);
+        batch += "] [";
+        batch += levelName(lvl);
+        batch += "] ";
+        batch.append(text);
+        batch += '\n';
+    }
+
+    // moves every published record into the batch and writes it out, returns records drained
+    size_t drain() {
+        refreshClock();
+        size_t n = 0;
+        while (true) {
+            size_t idx = readPos & RING_MASK;
+            if (loadSequence(idx) != readPos + 1) break;
+            Record& r = ring[idx];
+            appendLine(r.level, std::string_view(r.text, r.length));
+            storeSequence(idx, readPos + RING_SIZE);
+            readPos++;
+            n++;
+        }
+
+        uint64_t d = dropped.load(std::memory_order_relaxed);
+        if (d != reportedDrops) {
+            char msg[64];
+            int len = std::snprintf(msg, sizeof(msg), "logger dropped %llu messages, ring full",
+                                    (unsigned long long)(d - reportedDrops));
+            appendLine(Level::Warn, std::string_view(msg, (size_t)len));
+            reportedDrops = d;
+        }
+
+        if (!batch.empty()) {
+            std::fwrite(batch.data(), 1, batch.size(), stdout);
+            std::fflush(stdout);
+            batch.clear();
+        }
+        return n;
+    }
+
+    void run() {
+        while (running.load(std::memory_order_acquire)) {
+            // sleep only when the ring was empty, a busy ring is drained back to back
+            if (drain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        drain();
+    }
+
+    ~Writer() { shutdown(); }
+};
+
+Writer writer;
+
+} // namespace
+
+Record* claim() {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        size_t idx = pos & RING_MASK;
+        intptr_t diff = (intptr_t)loadSequence(idx) - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &ring[idx];
+        } else if (diff < 0) {
+            // the writer has not freed this slot yet, the ring is full
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void publish(Record* r) {
+    size_t idx = (size_t)(r - ring);
+    storeSequence(idx, loadSequence(idx) + 1);
+}
+
+void setLevel(Level lvl) {
+    runtimeLevel.store((int)lvl, std::memory_order_relaxed);
+}
+
+Level getLevel() {
+    return (Level)runtimeLevel.load(std::memory_order_relaxed);
+}
+
+bool parseLevel(std::string_view name, Level& out) {
+    auto eq = [&](std::string_view want) {
+        if (name.size() != want.size()) return false;
+        for (size_t i = 0; i < name.size(); i++) {
+            char c = name[i];
+            if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+            if (c != want[i]) return false;
+        }
+        return true;
+    };
+    if (eq("debug")) out = Level::Debug;
+    else if (eq("info")) out = Level::Info;
+    else if (eq("warn") || eq("warning")) out = Level::Warn;
+    else if (eq("error")) out = Level::Error;
+    else if (eq("off")) out = Level::Off;
+    else return false;
+    return true;
+}
+
+void init() {
+    std::lock_guard<std::mutex> lock(writer.lifecycle);
+    if (writer.running.load()) return;
+
+    if (const char* env = std::getenv("LOG_LEVEL")) {
+        Level lvl;
+        if (parseLevel(env, lvl)) setLevel(lvl);
+    }
+
+    writer.running.store(true, std::memory_order_release);
+    writer.thread = std::thread([] { writer.run(); });
+}
+
+void shutdown() {
+    std::lock_guard<std::mutex> lock(writer.lifecycle);
+    if (!writer.running.load()) return;
+    writer.running.store(false, std::memory_order_release);
+    if (writer.thread.joinable()) writer.thread.join();
+}
+
+uint64_t droppedCount() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace logging
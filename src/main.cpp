@@ -1,20 +1,85 @@
-#include <iostream>
 #include <string>
-#include "storage/murmurhash/murmurhash3.hpp"
+#include <cstdlib>
+#include <algorithm>
 #include "storage/RedisHashMap.hpp"
+#include "storage/PackedHash.hpp"
+#include "storage/IntSet.hpp"
 #include "parser/parser.hpp"
 #include "server/server.hpp"
+#ifndef _WIN32
+#include "server/core_server.hpp"
+#include "server/io_server.hpp"
+#endif
+#include "logging/logger.hpp"
+#ifdef _WIN32
 #include <conio.h>
+#endif
 
-int main() {
+int main(int argc, char** argv) {
+
+    // --threads N runs N event loops over the shared, sharded keyspace
+    // --read-optimized answers GET/EXISTS/STRLEN/HGET from lock-free snapshots
+    // --shared-nothing gives each of the threads a private part of the keyspace instead
+    // --io-threads N keeps one executor thread and moves socket work to N i/o threads
+    // --capacity N sizes the keyspace for N keys at startup instead of growing into it
+    // --hash-max-packed-fields N and --hash-max-packed-bytes N are the limits under which a hash
+    // stays packed into one buffer, see PackedHash
+    // --set-max-intset-entries N is the size up to which a set of integers stays a sorted array
+    int threads = 1;
+    int ioThreads = 0;
+    bool readOptimized = false;
+    bool sharedNothing = false;
+    size_t capacity = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--read-optimized") readOptimized = true;
+        else if (arg == "--shared-nothing") sharedNothing = true;
+        else if (arg == "--io-threads" && i + 1 < argc) ioThreads = std::atoi(argv[++i]);
+        else if (arg == "--capacity" && i + 1 < argc) capacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hash-max-packed-fields" && i + 1 < argc)
+            PackedHash::maxFields = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hash-max-packed-bytes" && i + 1 < argc)
+            PackedHash::maxBytes = std::min<size_t>(std::strtoull(argv[++i], nullptr, 10), PackedHash::BYTES_LIMIT);
+        else if (arg == "--set-max-intset-entries" && i + 1 < argc)
+            IntSet::maxEntries = std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    // start the background log writer first, LOG_LEVEL=debug turns on the per command traces
+    logging::init();
+
+#ifndef _WIN32
+    // thread per core: every core builds its own keyspace and parser
+    if (sharedNothing) {
+        CoreServer server(6379, threads, capacity);
+        if (server.start()) LOG_INFO("Server loop exited");
+        logging::shutdown();
+        return 0;
+    }
+#else
+    if (sharedNothing || ioThreads > 0)
+        LOG_WARN("--shared-nothing and --io-threads are only available on linux, using the default server");
+#endif
 
     // create a baseMap and then create it a parser and inject the baseMap into it
     // then create a server and inject the parser into it
     
     RedisHashMap baseMap(1024); 
+    if (capacity) baseMap.reserve(capacity);
+    if (readOptimized) baseMap.enableReadIndex();
     Parser parser(baseMap);
 
-    TcpServer server(6379, parser);  // inject parser
+#ifndef _WIN32
+    // a single executor runs every command, the i/o threads do the socket work around it
+    if (ioThreads > 0) {
+        IoServer server(6379, parser, ioThreads);
+        if (server.start()) LOG_INFO("Server loop exited");
+        logging::shutdown();
+        return 0;
+    }
+#endif
+
+    TcpServer server(6379, parser, threads);  // inject parser
 
     // we start the service
      // default Redis port
@@ -23,11 +88,16 @@ int main() {
         // The server is now running and listening for clients
         // It will block here in start() until you stop it
 
-        std::cout<<"check in main"<<std::endl;
+        LOG_INFO("Server loop exited");
     }
 
+    // flush whatever is still queued before exiting
+    logging::shutdown();
+
 
 
+#ifdef _WIN32
     getch();
+#endif
     return 0;
 }
\ No newline at end of file
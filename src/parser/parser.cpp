@@ -6,314 +6,485 @@
 #include "storage/hashmapstore.hpp"
 #include "storage/RedisObject.hpp"
 #include "storage/TTLPriorityQueue.hpp"
+#include "concurrency/epoch.hpp"
 
-#include <sstream>
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <cctype>
-#include <unordered_map>
+#include <cstdint>
+#include <optional>
 #include <stdexcept>
 
 // constructor 
 Parser::Parser(RedisHashMap& map)
     : baseMap(map) {}
 
+Parser::Parser(RedisHashMap& map, bool threadPrivate)
+    : baseMap(map), lockFree(threadPrivate) {
+    // registered before any EXPIRE so the keyspace's queue is created without a worker thread
+    if (lockFree) ttl = getGlobalTTL(&baseMap, false);
+}
 
-// tokenizer splits input into tokens by spaces
-std::vector<std::string> Parser::tokenize(const std::string& input) {
-    std::vector<std::string> tokens;
-    std::istringstream ss(input);
-    std::string tok;
 
-    while (ss >> tok) tokens.push_back(tok);
+// tokenizer splits input into tokens by whitespace
+// tokens are views into the input so nothing is copied, newlines count as whitespace
+std::vector<std::string_view> Parser::tokenize(std::string_view input) {
+    std::vector<std::string_view> tokens;
+    size_t i = 0;
+    while (i < input.size()) {
+        while (i < input.size() && std::isspace((unsigned char)input[i])) i++;
+        size_t start = i;
+        while (i < input.size() && !std::isspace((unsigned char)input[i])) i++;
+        if (i > start) tokens.push_back(input.substr(start, i - start));
+    }
     return tokens;
 }
 
-// public entry point called from your server
-std::string Parser::route(const std::string& rawInput) {
-    if (rawInput.empty())
-        return std::string("-ERR empty request");
-
-    // cleanup tcp newlines
-    std::string clean = rawInput;
-    clean.erase(std::remove(clean.begin(), clean.end(), '\r'), clean.end());
-    clean.erase(std::remove(clean.begin(), clean.end(), '\n'), clean.end());
-
-    auto tokens = tokenize(clean);
+// convenience entry point for a single plain text command line
+// returns the RESP encoded reply
+std::string Parser::route(std::string_view rawInput) {
+    std::string reply;
+    ReplyWriter out(reply);
 
+    auto tokens = tokenize(rawInput);
     if (tokens.empty())
-        return std::string("-ERR empty command");
+        out.error("ERR empty command");
+    else
+        processCommand(tokens, out);
+    return reply;
+}
 
-    return processCommand(tokens);
+// command table
+// a plain constexpr array, adding a command only needs a new entry here, the perfect hash
+// below is recomputed by the compiler. handlers are captureless lambdas so they decay to
+// plain function pointers and dispatch never goes through std::function
+static constexpr Parser::CommandSpec COMMANDS[] = {
+    // string commands
+    { "SET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR SET requires key value");
+                    return stringstore::set(m, t[1], t[2], out);
+                }, 3, 3, "SET key value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "SETNX", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR SETNX requires key value");
+                    return stringstore::setnx(m, t[1], t[2], out);
+                }, 3, 3, "SETNX key value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "MSET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR MSET requires key1 val1 [key2 val2 ...]");
+                    if ((t.size() - 1) % 2 != 0) return out.error("ERR MSET requires key value pairs");
+                    return stringstore::mset(m, t.subspan(1), out);
+                }, 3, -1, "MSET key value [key value ...]", { 1, -2, 2 }, Parser::CMD_WRITE },
+
+    { "MGET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR MGET requires at least one key");
+                    return stringstore::mget(m, t.subspan(1), out);
+                }, 2, -1, "MGET key [key ...]", { 1, -1, 1 }, Parser::CMD_READ },
+
+    { "GET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR GET requires key");
+                    return stringstore::get(m, t[1], out);
+                }, 2, 2, "GET key", { 1, 1, 1 }, Parser::CMD_READ,
+                [](const RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    return stringstore::getSnapshot(m, t[1], out);
+                } },
+
+    { "APPEND", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR APPEND requires key value");
+                    return stringstore::append(m, t[1], t[2], out);
+                }, 3, 3, "APPEND key value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "STRLEN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR STRLEN requires key");
+                    return stringstore::strlen_(m, t[1], out);
+                }, 2, 2, "STRLEN key", { 1, 1, 1 }, Parser::CMD_READ,
+                [](const RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    return stringstore::strlenSnapshot(m, t[1], out);
+                } },
+
+    { "INCR", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR INCR requires key");
+                    return stringstore::incr(m, t[1], out);
+                }, 2, 2, "INCR key", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "INCRBY", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR INCRBY requires key amount");
+                    return stringstore::incrby(m, t[1], t[2], out);
+                }, 3, 3, "INCRBY key amount", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "DECR", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR DECR requires key");
+                    return stringstore::decr(m, t[1], out);
+                }, 2, 2, "DECR key", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "DECRBY", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR DECRBY requires key amount");
+                    return stringstore::decrby(m, t[1], t[2], out);
+                }, 3, 3, "DECRBY key amount", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "INCRBYFLOAT", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR INCRBYFLOAT requires key increment");
+                    return stringstore::incrbyfloat(m, t[1], t[2], out);
+                }, 3, 3, "INCRBYFLOAT key increment", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "DEL", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR DEL requires key");
+                    return stringstore::del(m, t.subspan(1), out);
+                }, 2, -1, "DEL key [key ...]", { 1, -1, 1 }, Parser::CMD_WRITE },
+
+    { "EXISTS", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR EXISTS requires key");
+                    return stringstore::exists(m, t.subspan(1), out);
+                }, 2, -1, "EXISTS key [key ...]", { 1, -1, 1 }, Parser::CMD_READ,
+                [](const RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    return stringstore::existsSnapshot(m, t.subspan(1), out);
+                } },
+
+    { "RENAME", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR RENAME requires key newkey");
+                    return stringstore::rename(m, t[1], t[2], out);
+                }, 3, 3, "RENAME key newkey", { 1, 2, 1 }, Parser::CMD_WRITE },
+
+    { "COPY", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR COPY requires source destination");
+                    return stringstore::copy(m, t[1], t[2], out);
+                }, 3, 3, "COPY source destination", { 1, 2, 1 }, Parser::CMD_WRITE },
+
+    // no key spec, the shards are locked one at a time while the scan walks them
+    { "SCAN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR SCAN requires cursor");
+                    return stringstore::scan(m, t.subspan(1), out);
+                }, 2, -1, "SCAN cursor [MATCH pattern] [COUNT count]", { 0, 0, 0 }, Parser::CMD_READ },
+
+    // ---------------- LIST COMMANDS ----------------
+    { "LPUSH", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR LPUSH requires list value");
+                    return liststore::lpush(m, t[1], t[2], out);
+                }, 3, 3, "LPUSH list value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "RPUSH", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR RPUSH requires list value");
+                    return liststore::rpush(m, t[1], t[2], out);
+                }, 3, 3, "RPUSH list value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "LPOP", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR LPOP requires list");
+                    return liststore::lpop(m, t[1], out);
+                }, 2, 2, "LPOP list", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "RPOP", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR RPOP requires list");
+                    return liststore::rpop(m, t[1], out);
+                }, 2, 2, "RPOP list", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "LLEN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR LLEN requires list");
+                    return liststore::llen(m, t[1], out);
+                }, 2, 2, "LLEN list", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "LINDEX", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR LINDEX requires list and index");
+                    return liststore::lindex(m, t[1], t[2], out);
+                }, 3, 3, "LINDEX list index", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "LSET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 4) return out.error("ERR LSET requires list, index, and value");
+                    return liststore::lset(m, t[1], t[2], t[3], out);
+                }, 4, 4, "LSET list index value", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "LSORT", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR LSORT requires list and order");
+                    return liststore::lsort(m, t[1], t[2], out);
+                }, 3, 3, "LSORT list order", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "LPRINT", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 2) return out.error("ERR LPRINT requires list");
+                    return liststore::lprint(m, t[1], out);
+                }, 2, 2, "LPRINT list", { 1, 1, 1 }, Parser::CMD_READ },
+
+    // set commands
+    { "SADD", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SADD requires set value");
+                     return setstore::sadd(m, t[1], t[2], out);
+                 }, 3, -1, "SADD key member [member ...]", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "SREM", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SREM requires set value");
+                     return setstore::srem(m, t[1], t[2], out);
+                 }, 3, -1, "SREM key member [member ...]", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "SMEMBERS", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 2) return out.error("ERR SMEMBERS requires set");
+                     return setstore::smembers(m, t[1], out);
+                 }, 2, 2, "SMEMBERS key", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "SCARD", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 2) return out.error("ERR SCARD requires set");
+                     return setstore::scard(m, t[1], out);
+                 }, 2, 2, "SCARD key", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "SPOP", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 2) return out.error("ERR SPOP requires set");
+                     return setstore::spop(m, t[1], out);
+                 }, 2, 2, "SPOP key", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "SISMEMBER", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SISMEMBER requires set value");
+                     return setstore::sismember(m, t[1], t[2], out);
+                 }, 3, 3, "SISMEMBER key member", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "SSCAN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SSCAN requires key cursor");
+                     return setstore::sscan(m, t[1], t.subspan(2), out);
+                 }, 3, -1, "SSCAN key cursor [MATCH pattern] [COUNT count]", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "SUNION", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SUNION requires two sets");
+                     return setstore::sunion(m, t[1], t[2], out);
+                 }, 3, -1, "SUNION key1 key2 [key...]", { 1, -1, 1 }, Parser::CMD_READ },
+
+    { "SINTER", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR SINTER requires two sets");
+                     return setstore::sinter(m, t[1], t[2], out);
+                 }, 3, -1, "SINTER key1 key2 [key...]", { 1, -1, 1 }, Parser::CMD_READ },
+
+    { "SDIFF", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                    if (t.size() < 3) return out.error("ERR SDIFF requires two sets");
+                    return setstore::sdiff(m, t[1], t[2], out);
+                 }, 3, -1, "SDIFF key1 key2 [key...]", { 1, -1, 1 }, Parser::CMD_READ },
+
+    // ---------------- HASH COMMANDS ----------------
+    { "HSET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 4) return out.error("ERR HSET requires key field value");
+                     return hashmapstore::hset(m, t[1], t[2], t[3], out);
+                 }, 4, -1, "HSET key field value [field value ...]", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "HGET", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR HGET requires key field");
+                     return hashmapstore::hget(m, t[1], t[2], out);
+                 }, 3, 3, "HGET key field", { 1, 1, 1 }, Parser::CMD_READ,
+                 [](const RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     return hashmapstore::hgetSnapshot(m, t[1], t[2], out);
+                 } },
+
+    { "HDEL", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR HDEL requires key field(s)");
+                     return hashmapstore::hdel(m, t[1], t.subspan(2), out);
+                 }, 3, -1, "HDEL key field [field ...]", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "HEXISTS", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR HEXISTS requires key field");
+                     return hashmapstore::hexists(m, t[1], t[2], out);
+                 }, 3, 3, "HEXISTS key field", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "HLEN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 2) return out.error("ERR HLEN requires key");
+                     return hashmapstore::hlen(m, t[1], out);
+                 }, 2, 2, "HLEN key", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "HSCAN", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+                     if (t.size() < 3) return out.error("ERR HSCAN requires key cursor");
+                     return hashmapstore::hscan(m, t[1], t.subspan(2), out);
+                 }, 3, -1, "HSCAN key cursor [MATCH pattern] [COUNT count]", { 1, 1, 1 }, Parser::CMD_READ },
+
+    { "EXPIRE", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+    if (t.size() < 3) return out.error("ERR EXPIRE requires key seconds");
+    std::string_view key = t[1];
+    std::string_view secStr = t[2];
+    // parse seconds
+    long long seconds = 0;
+    auto [end, ec] = std::from_chars(secStr.data(), secStr.data() + secStr.size(), seconds);
+    if (ec != std::errc() || end != secStr.data() + secStr.size())
+        return out.error("ERR invalid seconds");
+    // if key doesnt exist in db return 0
+    if (!m.exists(key)) return out.integer(0);
+    // ensure global ttl queue is created and started
+    TTLPriorityQueue* q = getGlobalTTL(&m);
+    bool ok = q->insertOrUpdate(key, seconds);
+    return out.integer(ok ? 1 : 0);
+        }, 3, 3, "EXPIRE key seconds", { 1, 1, 1 }, Parser::CMD_WRITE },
+
+    { "TTL", [](RedisHashMap& m, Parser::Args t, ReplyWriter& out) {
+            if (t.size() < 2) return out.error("ERR TTL requires key");
+            std::string_view key = t[1];
+            // return -2 when key doesnt exist
+            if (!m.exists(key)) return out.integer(-2);
+            // if ttl not started return -1
+            TTLPriorityQueue* q = getGlobalTTL(&m);
+            long long rem = q->getTTLSeconds(key);
+            if (rem == -2) return out.integer(-2);
+            if (rem == -1) return out.integer(-1);
+            return out.integer(rem);
+        }, 2, 2, "TTL key", { 1, 1, 1 }, Parser::CMD_READ },
+};
+
+static constexpr size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// ascii uppercase without locale lookups, usable at compile time
+static constexpr unsigned char upperAscii(unsigned char c) {
+    return (c >= 'a' && c <= 'z') ? (unsigned char)(c - 'a' + 'A') : c;
 }
 
-// utility to change uppercase a string
-static std::string uppercpy(std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return std::toupper(c); });
-    return s;
+// seeded fnv-1a over the uppercased name so lookups are case insensitive
+static constexpr uint32_t commandHash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : name) {
+        h ^= upperAscii((unsigned char)c);
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    return h;
 }
 
+// slot count is a power of two with at least 4x headroom so a collision free seed is found fast
+static constexpr size_t slotCountFor(size_t n) {
+    size_t slots = 64;
+    while (slots < n * 4) slots *= 2;
+    return slots;
+}
 
-// command table 
-static const std::unordered_map<std::string, Parser::CommandSpec>& buildCommandTable() {
-    // construct once in a functiolocal static toavoid static initialization order issues
-    static const std::unordered_map<std::string, Parser::CommandSpec> table = {
-        // string commands
-        { "SET",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR SET requires key value");
-                        return stringstore::set(m, t[1], t[2]);
-                    }, 3, 3, "SET key value" } },
-
-        { "SETNX", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR SETNX requires key value");
-                        return stringstore::setnx(m, t[1], t[2]);
-                    }, 3, 3, "SETNX key value" } },
-
-        { "MSET",  { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR MSET requires key1 val1 [key2 val2 ...]");
-                        if ((t.size() - 1) % 2 != 0) return std::string("-ERR MSET requires key value pairs");
-                        std::vector<std::string> kvPairs(t.begin() + 1, t.end());
-                        return stringstore::mset(m, kvPairs);
-                    }, 3, -1, "MSET key value [key value ...]" } },
-
-        { "MGET",  { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR MGET requires at least one key");
-                        std::vector<std::string> keys(t.begin() + 1, t.end());
-                        return stringstore::mget(m, keys);
-                    }, 2, -1, "MGET key [key ...]" } },
-
-        { "GET",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR GET requires key");
-                        return stringstore::get(m, t[1]);
-                    }, 2, 2, "GET key" } },
-
-        { "APPEND",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR APPEND requires key value");
-                        return stringstore::append(m, t[1], t[2]);
-                    }, 3, 3, "APPEND key value" } },
-
-        { "STRLEN",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR STRLEN requires key");
-                        return stringstore::strlen_(m, t[1]);
-                    }, 2, 2, "STRLEN key" } },
-
-        { "INCR",  { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR INCR requires key");
-                        return stringstore::incr(m, t[1]);
-                    }, 2, 2, "INCR key" } },
-
-        { "INCRBY",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR INCRBY requires key amount");
-                        return stringstore::incrby(m, t[1], t[2]);
-                    }, 3, 3, "INCRBY key amount" } },
-
-        { "DECR",  { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR DECR requires key");
-                        return stringstore::decr(m, t[1]);
-                    }, 2, 2, "DECR key" } },
-
-        { "DECRBY",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR DECRBY requires key amount");
-                        return stringstore::decrby(m, t[1], t[2]);
-                    }, 3, 3, "DECRBY key amount" } },
-
-        { "DEL",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR DEL requires key");
-                        return stringstore::del(m, t[1]);
-                    }, 2, 2, "DEL key" } },
-
-        // ---------------- LIST COMMANDS ----------------
-        { "LPUSH",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR LPUSH requires list value");
-                        return liststore::lpush(m, t[1], t[2]);
-                    }, 3, 3, "LPUSH list value" } },
-
-        { "RPUSH",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR RPUSH requires list value");
-                        return liststore::rpush(m, t[1], t[2]);
-                    }, 3, 3, "RPUSH list value" } },
-
-        { "LPOP", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR LPOP requires list");
-                        return liststore::lpop(m, t[1]);
-                    }, 2, 2, "LPOP list" } },
-
-        { "RPOP", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR RPOP requires list");
-                        return liststore::rpop(m, t[1]);
-                    }, 2, 2, "RPOP list" } },
-
-        { "LLEN", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR LLEN requires list");
-                        return liststore::llen(m, t[1]);
-                    }, 2, 2, "LLEN list" } },
-
-        { "LINDEX",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR LINDEX requires list and index");
-                        return liststore::lindex(m, t[1], t[2]);
-                    }, 3, 3, "LINDEX list index" } },
-
-        { "LSET", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 4) return std::string("-ERR LSET requires list, index, and value");
-                        return liststore::lset(m, t[1], t[2], t[3]);
-                    }, 4, 4, "LSET list index value" } },
-
-        { "LSORT",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR LSORT requires list and order");
-                        return liststore::lsort(m, t[1], t[2]);
-                    }, 3, 3, "LSORT list order" } },
-
-        { "LPRINT",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 2) return std::string("-ERR LPRINT requires list");
-                        return liststore::lprint(m, t[1]);
-                    }, 2, 2, "LPRINT list" } },
-
-        // set commands
-        { "SADD",    { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR SADD requires set value");
-                         return setstore::sadd(m, t[1], t[2]);
-                     }, 3, -1, "SADD key member [member ...]" } },
-
-        { "SREM",    { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR SREM requires set value");
-                         return setstore::srem(m, t[1], t[2]);
-                     }, 3, -1, "SREM key member [member ...]" } },
-
-        { "SMEMBERS",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 2) return std::string("-ERR SMEMBERS requires set");
-                         return setstore::smembers(m, t[1]);
-                     }, 2, 2, "SMEMBERS key" } },
-
-        { "SCARD",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 2) return std::string("-ERR SCARD requires set");
-                         return setstore::scard(m, t[1]);
-                     }, 2, 2, "SCARD key" } },
-
-        { "SPOP",    { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 2) return std::string("-ERR SPOP requires set");
-                         return setstore::spop(m, t[1]);
-                     }, 2, 2, "SPOP key" } },
-
-        { "SISMEMBER",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR SISMEMBER requires set value");
-                         return setstore::sismember(m, t[1], t[2]);
-                     }, 3, 3, "SISMEMBER key member" } },
-
-        { "SUNION", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR SUNION requires two sets");
-                         return setstore::sunion(m, t[1], t[2]);
-                     }, 3, -1, "SUNION key1 key2 [key...]" } },
-
-        { "SINTER", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR SINTER requires two sets");
-                         return setstore::sinter(m, t[1], t[2]);
-                     }, 3, -1, "SINTER key1 key2 [key...]" } },
-
-        { "SDIFF", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                        if (t.size() < 3) return std::string("-ERR SDIFF requires two sets");
-                        return setstore::sdiff(m, t[1], t[2]);
-                     }, 3, -1, "SDIFF key1 key2 [key...]" } },
-
-        // ---------------- HASH COMMANDS ----------------
-        { "HSET",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 4) return std::string("-ERR HSET requires key field value");
-                         return hashmapstore::hset(m, t[1], t[2], t[3]);
-                     }, 4, -1, "HSET key field value [field value ...]" } },
-
-        { "HGET",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR HGET requires key field");
-                         return hashmapstore::hget(m, t[1], t[2]);
-                     }, 3, 3, "HGET key field" } },
-
-        { "HDEL",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR HDEL requires key field(s)");
-                         std::vector<std::string> fields(t.begin() + 2, t.end());
-                         return hashmapstore::hdel(m, t[1], fields);
-                     }, 3, -1, "HDEL key field [field ...]" } },
-
-        { "HEXISTS",{ [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 3) return std::string("-ERR HEXISTS requires key field");
-                         return hashmapstore::hexists(m, t[1], t[2]);
-                     }, 3, 3, "HEXISTS key field" } },
-
-        { "HLEN",   { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                         if (t.size() < 2) return std::string("-ERR HLEN requires key");
-                         return hashmapstore::hlen(m, t[1]);
-                     }, 2, 2, "HLEN key" } },
-
-        { "EXPIRE", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-        if (t.size() < 3) return std::string("-ERR EXPIRE requires key seconds");
-        const std::string key = t[1];
-        const std::string secStr = t[2];
-        // parse seconds
-        long long seconds = 0;
-        try {
-            size_t idx = 0;
-            seconds = std::stoll(secStr, &idx);
-            if (idx != secStr.size()) return std::string("-ERR invalid seconds");
-        } catch (...) {
-            return std::string("-ERR invalid seconds");
+static constexpr size_t COMMAND_SLOTS = slotCountFor(COMMAND_COUNT);
+
+struct PerfectHash {
+    uint32_t seed;
+    std::array<uint8_t, COMMAND_SLOTS> slots;   // COMMANDS index + 1, 0 marks an empty slot
+};
+
+// search for a seed under which every command name lands in its own slot
+// runs entirely inside the compiler, a duplicate name makes it fail to compile
+static constexpr PerfectHash buildPerfectHash() {
+    static_assert(COMMAND_COUNT < 255, "slot entries are stored as uint8_t");
+    for (uint32_t seed = 0; seed < 1000000; seed++) {
+        PerfectHash ph{ seed, {} };
+        bool ok = true;
+        for (size_t i = 0; i < COMMAND_COUNT && ok; i++) {
+            size_t slot = commandHash(COMMANDS[i].name, seed) & (COMMAND_SLOTS - 1);
+            if (ph.slots[slot] != 0) ok = false;
+            else ph.slots[slot] = (uint8_t)(i + 1);
         }
-        // if key doesnt exist in db return 0
-        if (!m.exists(key)) return std::string(":0");
-        // ensure global ttl queue is created and started
-        TTLPriorityQueue* q = getGlobalTTL(&m);
-        bool ok = q->insertOrUpdate(key, seconds);
-        return ok ? std::string(":1") : std::string(":0");
-            }, 3, 3, "EXPIRE key seconds"
-} },
-
-        {"TTL", { [](RedisHashMap& m, const std::vector<std::string>& t) {
-                if (t.size() < 2) return std::string("-ERR TTL requires key");
-                const std::string key = t[1];
-                // return -2 when key doesnt exist
-                if (!m.exists(key)) return std::string(":-2");
-                // if ttl not started return -1
-                TTLPriorityQueue* q = getGlobalTTL(&m);
-                long long rem = q->getTTLSeconds(key);
-                if (rem == -2) return std::string(":-2");
-                if (rem == -1) return std::string(":-1");
-                return std::string(":") + std::to_string(rem);
-            }, 2, 2, "TTL key"
-        } },
-
-    };
-    return table;
+        if (ok) return ph;
+    }
+    throw "no perfect hash seed found for the command table";
+}
+
+static constexpr PerfectHash COMMAND_HASH = buildPerfectHash();
+
+static bool equalsIgnoreCase(std::string_view upper, std::string_view s) {
+    if (upper.size() != s.size()) return false;
+    for (size_t i = 0; i < s.size(); i++)
+        if (upperAscii((unsigned char)s[i]) != (unsigned char)upper[i]) return false;
+    return true;
+}
+
+const Parser::CommandSpec* Parser::lookupCommand(std::string_view name) {
+    size_t slot = commandHash(name, COMMAND_HASH.seed) & (COMMAND_SLOTS - 1);
+    uint8_t idx = COMMAND_HASH.slots[slot];
+    if (idx == 0) return nullptr;
+    const CommandSpec& spec = COMMANDS[idx - 1];
+    return equalsIgnoreCase(spec.name, name) ? &spec : nullptr;
+}
+
+std::span<const Parser::CommandSpec> Parser::getCommandTable() {
+    return COMMANDS;
+}
+
+uint64_t Parser::keyShards(const CommandSpec& spec, Args tokens) const {
+    uint64_t mask = 0;
+    forEachKey(spec, tokens.size(), [&](size_t i) { mask |= baseMap.shardMask(tokens[i]); });
+    return mask;
 }
 
-const std::unordered_map<std::string, Parser::CommandSpec>& Parser::getCommandTable() {
-    return buildCommandTable();
+void Parser::publishKeys(const CommandSpec& spec, Args tokens) {
+    forEachKey(spec, tokens.size(), [&](size_t i) { baseMap.publish(tokens[i]); });
 }
 
 
 // command router now uses table lookup
-std::string Parser::processCommand(const std::vector<std::string>& tokens) {
-    if (tokens.empty()) return std::string("-ERR empty command");
-    std::string cmd = uppercpy(tokens[0]);
-
-    const auto& table = getCommandTable();
-    auto it = table.find(cmd);
-    if (it == table.end()) {
-        return std::string("-ERR unknown command");
+void Parser::processCommand(Args tokens, ReplyWriter& out) {
+    if (tokens.empty()) return out.error("ERR empty command");
+
+    const CommandSpec* found = lookupCommand(tokens[0]);
+    if (!found) {
+        return out.error("ERR unknown command");
     }
 
-    const CommandSpec& spec = it->second;
+    const CommandSpec& spec = *found;
 
     // basic arity check
-    size_t tcount = tokens.size();
-    if (tcount < static_cast<size_t>(spec.minArgs)) {
-        return std::string("-ERR wrong number of arguments for ") + cmd;
+    if (!arityOk(spec, tokens.size())) {
+        return out.error(std::string("ERR wrong number of arguments for ") + std::string(spec.name));
     }
-    if (spec.maxArgs != -1 && tcount > static_cast<size_t>(spec.maxArgs)) {
-        return std::string("-ERR wrong number of arguments for ") + cmd;
+
+    // read optimized mode: reads with a snapshot path take no lock, the epoch guard keeps the
+    // snapshots they look at alive until the reply is written
+    if (spec.snapshotRead && baseMap.readOptimized()) {
+        epoch::Guard epochGuard;
+        return spec.snapshotRead(baseMap, tokens, out);
     }
 
+    // lock the shards of every key the command touches for the whole handler, handlers hold
+    // RedisObject pointers across several map calls so the map can not lock per call.
+    // a thread private keyspace has nobody to lock against
+    std::optional<RedisHashMap::ShardGuard> guard;
+    if (!lockFree) guard.emplace(baseMap, keyShards(spec, tokens), spec.flags & CMD_WRITE);
+
     // call the handler which is responsible for any deeper validation
+    size_t start = out.mark();
     try {
-        return spec.handler(baseMap, tokens);
+        spec.handler(baseMap, tokens, out);
     } catch (const std::exception& e) {
-        // protect the server from exceptions in handlers
-        return std::string("-ERR handler exception: ") + e.what();
+        // protect the server from exceptions in handlers, drop whatever part of the reply was written
+        out.rollback(start);
+        out.error(std::string("ERR handler exception: ") + e.what());
     } catch (...) {
-        return std::string("-ERR unknown handler exception");
+        out.rollback(start);
+        out.error("ERR unknown handler exception");
+    }
+
+    // lock-free readers only see a write once the snapshots of its keys are rebuilt, this also
+    // runs after a failed handler since it may have changed something before throwing
+    if ((spec.flags & CMD_WRITE) && baseMap.readOptimized()) publishKeys(spec, tokens);
+}
+
+void Parser::processBatch(Args args, std::span<const uint32_t> argc, ReplyWriter& out) {
+    size_t next = 0;
+    for (size_t first = 0; first < argc.size(); first += PIPELINE_WINDOW) {
+        size_t end = std::min(argc.size(), first + PIPELINE_WINDOW);
+
+        // a lone request gains nothing from a prefetch pass, it would only hash its key twice
+        if (end - first > 1) {
+            std::string_view keys[PIPELINE_WINDOW];
+            size_t count = 0;
+            size_t pos = next;
+            for (size_t r = first; r < end; pos += argc[r], r++) {
+                Args tokens = args.subspan(pos, argc[r]);
+                const CommandSpec* spec = tokens.empty() ? nullptr : lookupCommand(tokens[0]);
+                if (!spec || spec->keys.first <= 0 || !arityOk(*spec, tokens.size())) continue;
+                // lock-free reads never touch the tables
+                if (spec->snapshotRead && baseMap.readOptimized()) continue;
+                keys[count++] = tokens[spec->keys.first];
+            }
+            if (count > 1) baseMap.prefetch(std::span<const std::string_view>(keys, count), !lockFree);
+        }
+
+        for (size_t r = first; r < end; r++) {
+            processCommand(args.subspan(next, argc[r]), out);
+            next += argc[r];
+        }
     }
 }
+
+bool Parser::hasIdleWork() const {
+    return baseMap.isRehashing();
+}
+
+bool Parser::idleWork() {
+    return baseMap.rehashFor(std::chrono::milliseconds(1));
+}
+
+int Parser::expireKeys() {
+    // bounded so a burst of expiries can not stall the clients of the loop, the rest is due at once
+    static constexpr size_t EXPIRE_BUDGET = 128;
+    return ttl ? ttl->expireDue(EXPIRE_BUDGET) : -1;
+}
@@ -0,0 +1,114 @@
+#include "parser/reply.hpp"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+// record tags, the resp type byte where there is one
+static constexpr char TAG_OK = 'O';
+static constexpr char TAG_NIL = 'N';
+static constexpr char TAG_NUMBER = '#';   // bulk(long long), the digits are formatted by render
+
+// writes <type><n>\r\n, numbers are formatted on the stack with to_chars
+void ReplyWriter::prefixed(char type, long long n) {
+    char buf[24];
+    buf[0] = type;
+    char* end = std::to_chars(buf + 1, buf + sizeof(buf) - 2, n).ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    out.append(buf, (size_t)(end - buf));
+}
+
+// <tag><8 byte number>
+void ReplyWriter::record(char tag, long long n) {
+    char buf[1 + sizeof(n)];
+    buf[0] = tag;
+    std::memcpy(buf + 1, &n, sizeof(n));
+    out.append(buf, sizeof(buf));
+}
+
+// <tag><4 byte length><bytes>
+void ReplyWriter::record(char tag, std::string_view s) {
+    char buf[1 + sizeof(uint32_t)];
+    uint32_t len = (uint32_t)s.size();
+    buf[0] = tag;
+    std::memcpy(buf + 1, &len, sizeof(len));
+    out.append(buf, sizeof(buf));
+    out.append(s);
+}
+
+void ReplyWriter::ok() {
+    if (records) out += TAG_OK;
+    else out.append("+OK\r\n", 5);
+}
+
+void ReplyWriter::simple(std::string_view s) {
+    if (records) return record('+', s);
+    out += '+';
+    out.append(s);
+    out.append("\r\n", 2);
+}
+
+void ReplyWriter::error(std::string_view msg) {
+    if (records) return record('-', msg);
+    out += '-';
+    out.append(msg);
+    out.append("\r\n", 2);
+}
+
+void ReplyWriter::integer(long long n) {
+    if (records) return record(':', n);
+    prefixed(':', n);
+}
+
+void ReplyWriter::bulk(std::string_view s) {
+    if (records) return record('$', s);
+    prefixed('$', (long long)s.size());
+    out.append(s);
+    out.append("\r\n", 2);
+}
+
+void ReplyWriter::bulk(long long n) {
+    if (records) return record(TAG_NUMBER, n);
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+    bulk(std::string_view(digits, (size_t)(end - digits)));
+}
+
+void ReplyWriter::nil() {
+    if (records) out += TAG_NIL;
+    else out.append("$-1\r\n", 5);
+}
+
+void ReplyWriter::arrayHeader(size_t n) {
+    if (records) return record('*', (long long)n);
+    prefixed('*', (long long)n);
+}
+
+void ReplyWriter::render(std::string_view recorded, std::string& resp) {
+    ReplyWriter w(resp);
+    const char* p = recorded.data();
+    const char* end = p + recorded.size();
+    while (p < end) {
+        char tag = *p++;
+        if (tag == TAG_OK) {
+            w.ok();
+        } else if (tag == TAG_NIL) {
+            w.nil();
+        } else if (tag == ':' || tag == '*' || tag == TAG_NUMBER) {
+            long long n;
+            std::memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            if (tag == ':') w.integer(n);
+            else if (tag == '*') w.arrayHeader((size_t)n);
+            else w.bulk(n);
+        } else {
+            uint32_t len;
+            std::memcpy(&len, p, sizeof(len));
+            std::string_view s(p + sizeof(len), len);
+            p += sizeof(len) + len;
+            if (tag == '+') w.simple(s);
+            else if (tag == '-') w.error(s);
+            else w.bulk(s);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "parser/resp.hpp"
+#include <cstring>
+
+// parse a strict base 10 integer from a header line, no spaces or plus sign allowed
+static bool parseLength(const char* p, size_t n, long long& out) {
+    if (n == 0 || n > 18) return false;
+    bool neg = false;
+    size_t i = 0;
+    if (p[0] == '-') {
+        neg = true;
+        i = 1;
+        if (n == 1) return false;
+    }
+    long long v = 0;
+    for (; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + (p[i] - '0');
+    }
+    out = neg ? -v : v;
+    return true;
+}
+
+void RespDecoder::reset() {
+    mode = Mode::Unknown;
+    pos = 0;
+    scanPos = 0;
+    multibulkLen = 0;
+    bulkLen = -1;
+    argRanges.clear();
+}
+
+RespDecoder::Result RespDecoder::fail(const char* msg) {
+    errorMsg = msg;
+    return Result::Error;
+}
+
+bool RespDecoder::findLine(const char* data, size_t len, size_t& lineEnd, size_t& next) {
+    if (scanPos < pos) scanPos = pos;
+    const char* nl = scanPos < len
+        ? static_cast<const char*>(std::memchr(data + scanPos, '\n', len - scanPos))
+        : nullptr;
+    if (!nl) {
+        scanPos = len; // remember how far we looked
+        return false;
+    }
+    next = (size_t)(nl - data) + 1;
+    lineEnd = next - 1;
+    if (lineEnd > pos && data[lineEnd - 1] == '\r') lineEnd--;
+    scanPos = next;
+    return true;
+}
+
+RespDecoder::Result RespDecoder::decode(const char* data, size_t len) {
+    while (pos < len) {
+        if (mode == Mode::Unknown)
+            mode = data[pos] == '*' ? Mode::Multibulk : Mode::Inline;
+
+        Result r = mode == Mode::Inline ? decodeInline(data, len) : decodeMultibulk(data, len);
+        if (r != Result::Incomplete || mode != Mode::Unknown) return r;
+        // an empty line or an empty multi bulk was skipped, look for the next request
+    }
+    return Result::Incomplete;
+}
+
+// inline requests are a single line of space separated words
+RespDecoder::Result RespDecoder::decodeInline(const char* data, size_t len) {
+    size_t lineEnd, next;
+    if (!findLine(data, len, lineEnd, next)) {
+        if (len - pos > MAX_INLINE_LEN) return fail("too big inline request");
+        return Result::Incomplete;
+    }
+    if (lineEnd - pos > MAX_INLINE_LEN) return fail("too big inline request");
+
+    argRanges.clear();
+    size_t i = pos;
+    while (i < lineEnd) {
+        while (i < lineEnd && (data[i] == ' ' || data[i] == '\t')) i++;
+        size_t start = i;
+        while (i < lineEnd && data[i] != ' ' && data[i] != '\t') i++;
+        if (i > start) argRanges.push_back({ start, i - start });
+    }
+
+    pos = next;
+    if (argRanges.empty()) {
+        // blank line, drop it and start over on whatever follows
+        mode = Mode::Unknown;
+        return Result::Incomplete;
+    }
+    return Result::Command;
+}
+
+// multi bulk requests are *<count> followed by count $<len> bulks
+RespDecoder::Result RespDecoder::decodeMultibulk(const char* data, size_t len) {
+    size_t lineEnd, next;
+
+    if (multibulkLen == 0) {
+        // still waiting for the *<count> header
+        if (!findLine(data, len, lineEnd, next)) {
+            if (len - pos > MAX_INLINE_LEN) return fail("too big mbulk count string");
+            return Result::Incomplete;
+        }
+        long long n;
+        if (!parseLength(data + pos + 1, lineEnd - pos - 1, n) || n > MAX_MULTIBULK_LEN)
+            return fail("invalid multibulk length");
+        pos = next;
+        if (n <= 0) {
+            // *0 and *-1 carry no command
+            mode = Mode::Unknown;
+            return Result::Incomplete;
+        }
+        multibulkLen = n;
+        argRanges.clear();
+        argRanges.reserve(n < 1024 ? (size_t)n : 1024);
+    }
+
+    while (multibulkLen > 0) {
+        if (bulkLen == -1) {
+            if (pos >= len) return Result::Incomplete;
+            if (data[pos] != '$') return fail("expected '$'");
+            if (!findLine(data, len, lineEnd, next)) {
+                if (len - pos > MAX_INLINE_LEN) return fail("too big bulk count string");
+                return Result::Incomplete;
+            }
+            long long n;
+            if (!parseLength(data + pos + 1, lineEnd - pos - 1, n) || n < 0 || n > MAX_BULK_LEN)
+                return fail("invalid bulk length");
+            pos = next;
+            bulkLen = n;
+        }
+
+        // the payload is binary safe, only its length matters so nothing is scanned here
+        if (len - pos < (size_t)bulkLen + 2) return Result::Incomplete;
+        if (data[pos + bulkLen] != '\r' || data[pos + bulkLen + 1] != '\n')
+            return fail("bulk not terminated by CRLF");
+
+        argRanges.push_back({ pos, (size_t)bulkLen });
+        pos += (size_t)bulkLen + 2;
+        bulkLen = -1;
+        multibulkLen--;
+    }
+
+    return Result::Command;
+}
@@ -0,0 +1,74 @@
+#include "server/connection.hpp"
+#include "parser/parser.hpp"
+
+bool Connection::nextRequest() {
+    if (closing) return false;
+
+    const char* data = inBuf.data() + inPos;
+    RespDecoder::Result r = decoder.decode(data, inBuf.size() - inPos);
+
+    if (r == RespDecoder::Result::Incomplete) return false;
+    if (r == RespDecoder::Result::Error) {
+        // like redis we answer once and then drop the client, the stream can not be resynchronised
+        outBuf += "-ERR Protocol error: ";
+        outBuf += decoder.error();
+        outBuf += "\r\n";
+        closing = true;
+        return false;
+    }
+
+    const auto& ranges = decoder.args();
+    args.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++)
+        args[i] = std::string_view(data + ranges[i].offset, ranges[i].length);
+
+    inPos += decoder.consumed();
+    decoder.reset();
+    return true;
+}
+
+void Connection::compactInput() {
+    if (inPos == 0) return;
+    if (inPos >= inBuf.size()) {
+        inBuf.clear();
+    } else {
+        inBuf.erase(0, inPos);
+        // the decoder may be half way through a request, its offsets are relative to inPos
+        // so moving the bytes to the front does not disturb it
+    }
+    inPos = 0;
+}
+
+size_t Connection::executePending(Parser& parser) {
+    // a fully sent buffer is reset here rather than after every send so its capacity is reused
+    if (outPos > 0 && outPos == outBuf.size()) {
+        outBuf.clear();
+        outPos = 0;
+    }
+
+    // the argument views point into inBuf, which stays put until compactInput()
+    batchArgs.clear();
+    batchArgc.clear();
+    size_t errorAt = outBuf.size();
+    while (nextRequest()) {
+        batchArgs.insert(batchArgs.end(), args.begin(), args.end());
+        batchArgc.push_back((uint32_t)args.size());
+    }
+
+    // a protocol error after the last complete request was queued already, it has to follow
+    // the replies of the requests before it
+    std::string error;
+    if (closing && outBuf.size() > errorAt) {
+        error = outBuf.substr(errorAt);
+        outBuf.resize(errorAt);
+    }
+
+    // replies are serialized straight into outBuf
+    ReplyWriter out(outBuf);
+    if (batchArgc.size() == 1) parser.processCommand(batchArgs, out);
+    else if (!batchArgc.empty()) parser.processBatch(batchArgs, batchArgc, out);
+    outBuf += error;
+
+    compactInput();
+    return batchArgc.size();
+}
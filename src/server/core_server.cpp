@@ -0,0 +1,559 @@
+// shared-nothing thread per core server, see core_server.hpp
+
+#include "server/core_server.hpp"
+#include "server/socket_io.hpp"
+#include "logging/logger.hpp"
+#include "storage/hash/keyhash.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static const int MAX_EVENTS = 1024;           // events drained per epoll_wait call
+static const size_t QUEUE_CAPACITY = 4096;    // messages per core to core ring
+static const size_t INBOX_BATCH = 1024;       // messages taken from one ring per loop turn
+
+static const std::string_view OK_REPLY = "+OK\r\n";
+
+// the elements of a one element array reply, "*1\r\n$1\r\nx\r\n" -> "$1\r\nx\r\n"
+static std::string_view arrayElements(std::string_view reply) {
+    if (reply.empty() || reply[0] != '*') return reply;
+    size_t end = reply.find("\r\n");
+    return end == std::string_view::npos ? reply : reply.substr(end + 2);
+}
+
+// the cursor a client sees is the core number above RedisHashMap::SCAN_CURSOR_BITS and that
+// core's own cursor below them. a core that is done hands the walk on to the next one, only
+// the last core's 0 ends it. error replies are left alone
+static void rebaseScanCursor(std::string& reply, uint32_t core, uint32_t cores) {
+    // "*2\r\n$<n>\r\n<cursor>\r\n..."
+    if (reply.compare(0, 5, "*2\r\n$") != 0) return;
+    size_t lenEnd = reply.find("\r\n", 5);
+    if (lenEnd == std::string::npos) return;
+    size_t start = lenEnd + 2;
+    size_t stop = reply.find("\r\n", start);
+    uint64_t local = 0;
+    if (stop == std::string::npos ||
+        std::from_chars(reply.data() + start, reply.data() + stop, local).ec != std::errc()) return;
+
+    uint64_t next = local != 0 ? (uint64_t)core << RedisHashMap::SCAN_CURSOR_BITS | local
+                  : core + 1 < cores ? (uint64_t)(core + 1) << RedisHashMap::SCAN_CURSOR_BITS : 0;
+    std::string head;
+    ReplyWriter(head).bulk(std::to_string(next));
+    reply.replace(4, stop + 2 - 4, head);
+}
+
+CoreServer::CoreServer(int port, int cores, size_t capacity)
+    : port(port), coreCount(cores < 1 ? 1 : (uint32_t)cores), capacity(capacity) {}
+
+CoreServer::~CoreServer() {
+    stop();
+
+    for (auto& core : cores) {
+        for (auto& kv : core->clients) close(kv.second.conn.fd);
+        if (core->listenFd != -1) close(core->listenFd);
+        if (core->epollFd != -1) close(core->epollFd);
+        if (core->wakeFd != -1) close(core->wakeFd);
+        for (auto& pending : core->backlog)
+            for (Message* m : pending) delete m;
+    }
+    // messages still in flight when the loops stopped
+    for (auto& q : queues) {
+        Message* m;
+        while (q && q->pop(m)) delete m;
+    }
+}
+
+// the owner is picked from the high bits of a fibonacci remix of the hash, the core's own
+// keyspace indexes its table with the low ones
+uint32_t CoreServer::ownerOf(std::string_view key) const {
+    uint64_t high = (keyhash::hash(key) * 0x9E3779B97F4A7C15ull) >> 32;
+    return (uint32_t)((high * coreCount) >> 32);
+}
+
+bool CoreServer::start() {
+    queues.resize((size_t)coreCount * coreCount);
+    for (uint32_t from = 0; from < coreCount; from++)
+        for (uint32_t to = 0; to < coreCount; to++)
+            if (from != to) queues[from * coreCount + to] = std::make_unique<SpscQueue<Message*>>(QUEUE_CAPACITY);
+
+    for (uint32_t i = 0; i < coreCount; i++) {
+        auto core = std::make_unique<Core>();
+        core->index = i;
+        // the keyspace is private to the core, a single partition is enough
+        core->map = std::make_unique<RedisHashMap>(1024, 1);
+        if (capacity) core->map->reserve(capacity / coreCount);
+        core->parser = std::make_unique<Parser>(*core->map, true);
+        core->backlog.resize(coreCount);
+        core->needsWake.assign(coreCount, 0);
+        cores.push_back(std::move(core));
+        if (!openCore(*cores.back())) return false;
+    }
+
+    running = true;
+    LOG_INFO("Server started on port ", port, " with ", coreCount, " shared-nothing core(s)");
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < coreCount; i++)
+        workers.emplace_back([this, i] { runCore(*cores[i]); });
+
+    runCore(*cores[0]);
+    for (auto& w : workers) w.join();
+    return true;
+}
+
+void CoreServer::stop() {
+    if (!running) return;
+
+    running = false;
+    for (auto& core : cores) {
+        if (core->wakeFd == -1) continue;
+        uint64_t one = 1;
+        ssize_t ignored = write(core->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    LOG_INFO("Server stopped.");
+}
+
+bool CoreServer::openCore(Core& core) {
+    core.listenFd = sockio::openListener(port, coreCount > 1);
+    if (core.listenFd == -1) return false;
+
+    core.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    core.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (core.epollFd == -1 || core.wakeFd == -1) {
+        LOG_ERROR("epoll setup failed: ", std::strerror(errno));
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = LISTEN_ID;
+    epoll_ctl(core.epollFd, EPOLL_CTL_ADD, core.listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_ID;
+    epoll_ctl(core.epollFd, EPOLL_CTL_ADD, core.wakeFd, &ev);
+    return true;
+}
+
+void CoreServer::runCore(Core& core) {
+    // keep the loop on its own cpu so its keyspace stays in that core's cache
+    unsigned cpus = std::thread::hardware_concurrency();
+    if (cpus > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core.index % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    epoll_event events[MAX_EVENTS];
+    bool idlePending = false;   // the parser has background work for quiet moments
+    bool more = false;          // messages left in the inbox or stuck in the backlog
+
+    while (running) {
+        // keys expire on the loop between events, the wait ends in time for the next one due
+        int timeout = core.parser->expireKeys();
+        if (idlePending || more) timeout = 0;
+        int n = epoll_wait(core.epollFd, events, MAX_EVENTS, timeout);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: ", std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            uint32_t mask = events[i].events;
+
+            if (id == LISTEN_ID) {
+                acceptClients(core);
+                continue;
+            }
+            if (id == WAKE_ID) {
+                // reset before draining, a message queued after this read wakes the loop again
+                uint64_t v;
+                while (read(core.wakeFd, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+
+            auto it = core.clients.find(id);
+            if (it == core.clients.end()) continue;
+            Client& client = it->second;
+
+            bool alive = !(mask & EPOLLERR);
+            if (alive && (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) alive = handleRead(core, client, id);
+            if (alive && (mask & EPOLLOUT)) {
+                client.conn.writeBlocked = false;
+                alive = sockio::flushWrites(client.conn);
+            }
+
+            if (!alive) closeClient(core, id);
+        }
+
+        more = drainInbox(core);
+        more |= flushBacklog(core);
+        wakeTargets(core);
+        flushDirty(core);
+
+        if (n == 0 && !more) idlePending = core.parser->idleWork();
+        else idlePending = core.parser->hasIdleWork();
+    }
+}
+
+void CoreServer::acceptClients(Core& core) {
+    int fd;
+    while ((fd = sockio::acceptClient(core.listenFd)) != -1) {
+        uint64_t id = core.nextClientId++;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = id;
+        if (epoll_ctl(core.epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            continue;
+        }
+
+        core.clients[id].conn.fd = fd;
+    }
+}
+
+bool CoreServer::handleRead(Core& core, Client& client, uint64_t id) {
+    Connection& conn = client.conn;
+    bool peerClosed = false;
+    if (!sockio::readAvailable(conn, peerClosed)) return false;
+
+    while (true) {
+        size_t before = conn.outBuf.size();
+        if (!conn.nextRequest()) {
+            // a protocol error reply is written straight to outBuf, it has to wait its turn
+            // behind the replies other cores still owe
+            if (conn.closing && !client.slots.empty() && conn.outBuf.size() > before) {
+                Slot slot;
+                slot.reply = conn.outBuf.substr(before);
+                conn.outBuf.resize(before);
+                client.slots.push_back(std::move(slot));
+            }
+            break;
+        }
+        route(core, client, id, conn.args);
+    }
+    conn.compactInput();
+    // a half closed client still gets the replies to everything it sent, other cores may owe some
+    if (peerClosed) conn.closing = true;
+
+    // the client stays until the other cores have answered everything it sent before the error
+    // or the eof, flushDirty closes it once they have
+    if (conn.closing && client.slots.empty()) {
+        sockio::flushWrites(conn);
+        return false;
+    }
+    if (!conn.writeBlocked && !sockio::flushWrites(conn)) return false;
+    return true;
+}
+
+void CoreServer::closeClient(Core& core, uint64_t id) {
+    auto it = core.clients.find(id);
+    if (it == core.clients.end()) return;
+    int fd = it->second.conn.fd;
+    epoll_ctl(core.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    // replies still on their way for this client are dropped when they arrive
+    core.clients.erase(it);
+}
+
+std::string& CoreServer::replyTarget(Client& client) {
+    if (client.slots.empty()) return client.conn.outBuf;
+    client.slots.emplace_back();
+    return client.slots.back().reply;
+}
+
+void CoreServer::route(Core& core, Client& client, uint64_t id, Parser::Args args) {
+    const Parser::CommandSpec* spec = args.empty() ? nullptr : Parser::lookupCommand(args[0]);
+
+    // unknown commands and arity errors are answered by the parser where the client is
+    uint32_t owner = core.index;
+    bool spread = false;
+    if (spec && spec->name == "SCAN" && Parser::arityOk(*spec, args.size()))
+        return routeScan(core, client, id, args);
+    if (spec && Parser::arityOk(*spec, args.size())) {
+        bool first = true;
+        Parser::forEachKey(*spec, args.size(), [&](size_t i) {
+            uint32_t o = ownerOf(args[i]);
+            if (first) owner = o;
+            else if (o != owner) spread = true;
+            first = false;
+        });
+    }
+
+    if (!spread && owner == core.index) {
+        ReplyWriter out(replyTarget(client));
+        core.parser->processCommand(args, out);
+        return;
+    }
+
+    uint64_t seq = client.firstSeq + client.slots.size();
+
+    if (!spread) {
+        client.slots.emplace_back();
+        client.slots.back().missing = 1;
+        send(core, owner, makeMessage(core, id, seq, 0, args));
+        return;
+    }
+
+    if (spec->name == "MGET") {
+        // one single key MGET per key, the elements are spliced back in key order
+        size_t keys = args.size() - 1;
+        client.slots.emplace_back();
+        Slot& slot = client.slots.back();
+        slot.gather = Gather::Array;
+        slot.parts.resize(keys);
+        slot.missing = (uint32_t)keys;
+
+        for (size_t k = 0; k < keys; k++) {
+            std::string_view piece[] = { args[0], args[k + 1] };
+            uint32_t o = ownerOf(args[k + 1]);
+            if (o == core.index) {
+                std::string reply;
+                ReplyWriter out(reply);
+                core.parser->processCommand(piece, out);
+                slot.parts[k] = std::string(arrayElements(reply));
+                slot.missing--;
+            } else {
+                send(core, o, makeMessage(core, id, seq, (uint32_t)k, piece));
+            }
+        }
+        return;
+    }
+
+    if (spec->name == "MSET" || spec->name == "DEL" || spec->name == "EXISTS") {
+        // one piece per core with the keys (pairs for MSET) it owns. MSET answers OK unless a
+        // piece failed, DEL and EXISTS add up the counts of the pieces
+        size_t step = (size_t)spec->keys.step;
+        // a key without its value would be dropped by the split, the parser rejects the whole
+        // command like it does without sharding
+        if ((args.size() - 1) % step != 0) {
+            ReplyWriter out(replyTarget(client));
+            core.parser->processCommand(args, out);
+            return;
+        }
+        std::vector<std::vector<std::string_view>> groups(coreCount);
+        for (size_t i = 1; i + step <= args.size(); i += step) {
+            auto& g = groups[ownerOf(args[i])];
+            if (g.empty()) g.push_back(args[0]);
+            g.insert(g.end(), args.begin() + i, args.begin() + i + step);
+        }
+
+        client.slots.emplace_back();
+        Slot& slot = client.slots.back();
+        if (spec->name == "MSET") {
+            slot.gather = Gather::AllOk;
+            slot.reply = OK_REPLY;
+        } else {
+            slot.gather = Gather::Sum;
+        }
+        for (uint32_t o = 0; o < coreCount; o++) {
+            if (groups[o].empty()) continue;
+            if (o == core.index) {
+                std::string reply;
+                ReplyWriter out(reply);
+                core.parser->processCommand(groups[o], out);
+                gatherPart(slot, std::move(reply), o);
+            } else {
+                slot.missing++;
+                send(core, o, makeMessage(core, id, seq, o, groups[o]));
+            }
+        }
+        return;
+    }
+
+    ReplyWriter out(replyTarget(client));
+    out.error("CROSSSLOT Keys in request don't hash to the same slot");
+}
+
+void CoreServer::routeScan(Core& core, Client& client, uint64_t id, Parser::Args args) {
+    std::string_view arg = args[1];
+    uint64_t cursor = 0;
+    auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), cursor);
+    uint64_t target = cursor >> RedisHashMap::SCAN_CURSOR_BITS;
+    if (ec != std::errc() || end != arg.data() + arg.size() || target >= coreCount) {
+        ReplyWriter out(replyTarget(client));
+        return out.error("ERR invalid cursor");
+    }
+
+    std::string local = std::to_string(cursor & ((uint64_t(1) << RedisHashMap::SCAN_CURSOR_BITS) - 1));
+    std::vector<std::string_view> piece(args.begin(), args.end());
+    piece[1] = local;
+
+    if (target == core.index) {
+        std::string reply;
+        ReplyWriter out(reply);
+        core.parser->processCommand(piece, out);
+        rebaseScanCursor(reply, core.index, coreCount);
+        replyTarget(client) += reply;
+        return;
+    }
+
+    uint64_t seq = client.firstSeq + client.slots.size();
+    client.slots.emplace_back();
+    client.slots.back().gather = Gather::Scan;
+    client.slots.back().missing = 1;
+    send(core, (uint32_t)target, makeMessage(core, id, seq, (uint32_t)target, piece));
+}
+
+CoreServer::Message* CoreServer::makeMessage(Core& core, uint64_t id, uint64_t seq, uint32_t part,
+                                             Parser::Args args) {
+    Message* msg = new Message();
+    msg->origin = core.index;
+    msg->client = id;
+    msg->seq = seq;
+    msg->part = part;
+    msg->args.assign(args.begin(), args.end());
+    return msg;
+}
+
+// the ring keeps the order of everything sent to a target, so once something waits in the
+// backlog every later message has to wait behind it
+void CoreServer::send(Core& core, uint32_t target, Message* msg) {
+    auto& pending = core.backlog[target];
+    if (!pending.empty() || !queue(core.index, target).push(msg)) pending.push_back(msg);
+    core.needsWake[target] = 1;
+}
+
+bool CoreServer::flushBacklog(Core& core) {
+    bool left = false;
+    for (uint32_t t = 0; t < coreCount; t++) {
+        auto& pending = core.backlog[t];
+        if (pending.empty()) continue;
+        auto& q = queue(core.index, t);
+        while (!pending.empty() && q.push(pending.front())) {
+            pending.pop_front();
+            core.needsWake[t] = 1;
+        }
+        left |= !pending.empty();
+    }
+    return left;
+}
+
+// one eventfd write per target and loop turn, however many messages went to it
+void CoreServer::wakeTargets(Core& core) {
+    for (uint32_t t = 0; t < coreCount; t++) {
+        if (!core.needsWake[t]) continue;
+        core.needsWake[t] = 0;
+        uint64_t one = 1;
+        ssize_t ignored = write(cores[t]->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+bool CoreServer::drainInbox(Core& core) {
+    bool left = false;
+    for (uint32_t from = 0; from < coreCount; from++) {
+        if (from == core.index) continue;
+        auto& q = queue(from, core.index);
+        Message* msg;
+        size_t taken = 0;
+        while (taken < INBOX_BATCH && q.pop(msg)) {
+            taken++;
+            if (msg->done) {
+                deliver(core, msg);
+                continue;
+            }
+            // a request for a key this core owns, run it and send the reply home
+            core.scratch.assign(msg->args.begin(), msg->args.end());
+            ReplyWriter out(msg->reply);
+            core.parser->processCommand(core.scratch, out);
+            msg->done = true;
+            send(core, msg->origin, msg);
+        }
+        left |= taken == INBOX_BATCH;
+    }
+    return left;
+}
+
+void CoreServer::deliver(Core& core, Message* msg) {
+    auto it = core.clients.find(msg->client);
+    if (it == core.clients.end()) {
+        delete msg;   // the client went away while the request was out
+        return;
+    }
+    Client& client = it->second;
+    Slot& slot = client.slots[msg->seq - client.firstSeq];
+
+    gatherPart(slot, std::move(msg->reply), msg->part);
+    slot.missing--;
+    delete msg;
+
+    completeSlots(client);
+    core.dirty.push_back(it->first);
+}
+
+// folds the reply of one piece into the slot, a piece that failed replaces the gathered reply
+void CoreServer::gatherPart(Slot& slot, std::string&& reply, uint32_t part) const {
+    switch (slot.gather) {
+        case Gather::None:
+            slot.reply = std::move(reply);
+            break;
+        case Gather::Array:
+            slot.parts[part] = std::string(arrayElements(reply));
+            break;
+        case Gather::Scan:
+            // part is the core that walked its keyspace
+            rebaseScanCursor(reply, part, coreCount);
+            slot.reply = std::move(reply);
+            break;
+        case Gather::AllOk:
+            if (reply != OK_REPLY) slot.reply = std::move(reply);
+            break;
+        case Gather::Sum: {
+            // ":<n>\r\n"
+            long long n = 0;
+            bool isInteger = !reply.empty() && reply[0] == ':' &&
+                             std::from_chars(reply.data() + 1, reply.data() + reply.size(), n).ec == std::errc();
+            if (isInteger) slot.total += n;
+            else slot.reply = std::move(reply);
+            break;
+        }
+    }
+}
+
+// moves every finished reply at the front into the output buffer
+void CoreServer::completeSlots(Client& client) {
+    std::string& outBuf = client.conn.outBuf;
+    while (!client.slots.empty() && client.slots.front().missing == 0) {
+        Slot& slot = client.slots.front();
+        if (slot.gather == Gather::Array) {
+            ReplyWriter(outBuf).arrayHeader(slot.parts.size());
+            for (auto& part : slot.parts) outBuf += part;
+        } else if (slot.gather == Gather::Sum && slot.reply.empty()) {
+            ReplyWriter(outBuf).integer(slot.total);
+        } else {
+            outBuf += slot.reply;
+        }
+        client.slots.pop_front();
+        client.firstSeq++;
+    }
+}
+
+void CoreServer::flushDirty(Core& core) {
+    for (uint64_t id : core.dirty) {
+        auto it = core.clients.find(id);
+        if (it == core.clients.end()) continue;
+        Connection& conn = it->second.conn;
+
+        bool alive = conn.writeBlocked || sockio::flushWrites(conn);
+        // a client that sent a broken request is closed once everything before it is answered
+        if (alive && conn.closing && it->second.slots.empty()) {
+            if (!conn.writeBlocked) sockio::flushWrites(conn);
+            alive = false;
+        }
+        if (!alive) closeClient(core, id);
+    }
+    core.dirty.clear();
+}
@@ -0,0 +1,326 @@
+// threaded i/o server with a single executor, see io_server.hpp
+
+#include "server/io_server.hpp"
+#include "server/socket_io.hpp"
+#include "logging/logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static const int MAX_EVENTS = 1024;            // events drained per epoll_wait call
+static const size_t REQUEST_CAPACITY = 8192;   // batches the executor ring holds
+static const size_t REPLY_CAPACITY = 4096;     // batches each reply ring holds
+
+static void wake(int fd) {
+    uint64_t one = 1;
+    ssize_t ignored = write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+IoServer::IoServer(int port, Parser& p, int ioThreads)
+    : parser(p), port(port), loopCount(ioThreads < 1 ? 1 : (uint32_t)ioThreads),
+      requests(REQUEST_CAPACITY) {}
+
+IoServer::~IoServer() {
+    stop();
+
+    Batch* b;
+    while (requests.pop(b)) delete b;
+    for (auto& loop : loops) {
+        for (auto& kv : loop->clients) close(kv.second.conn.fd);
+        if (loop->listenFd != -1) close(loop->listenFd);
+        if (loop->epollFd != -1) close(loop->epollFd);
+        if (loop->wakeFd != -1) close(loop->wakeFd);
+        for (Batch* pending : loop->backlog) delete pending;
+        while (loop->replies && loop->replies->pop(b)) delete b;
+    }
+    if (executorWakeFd != -1) close(executorWakeFd);
+}
+
+bool IoServer::start() {
+    executorWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (executorWakeFd == -1) {
+        LOG_ERROR("eventfd failed: ", std::strerror(errno));
+        return false;
+    }
+
+    for (uint32_t i = 0; i < loopCount; i++) {
+        auto loop = std::make_unique<IoLoop>();
+        loop->index = i;
+        loop->replies = std::make_unique<SpscQueue<Batch*>>(REPLY_CAPACITY);
+        loops.push_back(std::move(loop));
+        if (!openLoop(*loops.back())) return false;
+    }
+
+    running = true;
+    LOG_INFO("Server started on port ", port, " with ", loopCount, " i/o thread(s) and one executor");
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < loopCount; i++)
+        workers.emplace_back([this, i] { runLoop(*loops[i]); });
+
+    runExecutor();
+    for (auto& w : workers) w.join();
+    return true;
+}
+
+void IoServer::stop() {
+    if (!running) return;
+
+    running = false;
+    for (auto& loop : loops)
+        if (loop->wakeFd != -1) wake(loop->wakeFd);
+    if (executorWakeFd != -1) wake(executorWakeFd);
+    LOG_INFO("Server stopped.");
+}
+
+bool IoServer::openLoop(IoLoop& loop) {
+    loop.listenFd = sockio::openListener(port, loopCount > 1);
+    if (loop.listenFd == -1) return false;
+
+    loop.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    loop.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.epollFd == -1 || loop.wakeFd == -1) {
+        LOG_ERROR("epoll setup failed: ", std::strerror(errno));
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = LISTEN_ID;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, loop.listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_ID;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, loop.wakeFd, &ev);
+    return true;
+}
+
+// ---------------- i/o threads ----------------
+
+void IoServer::runLoop(IoLoop& loop) {
+    epoll_event events[MAX_EVENTS];
+    bool backlogged = false;   // the executor ring was full, retry without sleeping
+
+    while (running) {
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, backlogged ? 0 : -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: ", std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            uint32_t mask = events[i].events;
+
+            if (id == LISTEN_ID) {
+                acceptClients(loop);
+                continue;
+            }
+            if (id == WAKE_ID) {
+                // reset before draining, replies queued after this read wake the loop again
+                uint64_t v;
+                while (read(loop.wakeFd, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+
+            auto it = loop.clients.find(id);
+            if (it == loop.clients.end()) continue;
+            Client& client = it->second;
+
+            bool alive = !(mask & EPOLLERR);
+            if (alive && (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) alive = handleRead(loop, client, id);
+            if (alive && (mask & EPOLLOUT)) {
+                client.conn.writeBlocked = false;
+                alive = sockio::flushWrites(client.conn);
+            }
+
+            if (!alive) closeClient(loop, id);
+        }
+
+        receiveReplies(loop);
+        backlogged = submit(loop);
+    }
+}
+
+void IoServer::acceptClients(IoLoop& loop) {
+    int fd;
+    while ((fd = sockio::acceptClient(loop.listenFd)) != -1) {
+        uint64_t id = loop.nextClientId++;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = id;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            continue;
+        }
+
+        loop.clients[id].conn.fd = fd;
+    }
+}
+
+// frames everything that was received into one batch, the executor gets a private copy of the
+// bytes so the connection buffer can be reused right away
+bool IoServer::handleRead(IoLoop& loop, Client& client, uint64_t id) {
+    Connection& conn = client.conn;
+    bool peerClosed = false;
+    if (!sockio::readAvailable(conn, peerClosed)) return false;
+
+    size_t start = conn.inPos;
+    const char* base = conn.inBuf.data() + start;
+    Batch* batch = nullptr;
+    size_t errorAt = conn.outBuf.size();
+
+    while (conn.nextRequest()) {
+        if (!batch) {
+            batch = new Batch();
+            batch->loop = loop.index;
+            batch->client = id;
+        }
+        batch->argc.push_back((uint32_t)conn.args.size());
+        for (std::string_view a : conn.args)
+            batch->args.emplace_back((uint32_t)(a.data() - base), (uint32_t)a.size());
+    }
+
+    if (batch) {
+        batch->input.assign(base, conn.inPos - start);
+        loop.backlog.push_back(batch);
+        client.inFlight++;
+    }
+    conn.compactInput();
+    // a half closed client still gets the replies of the batches it sent, receiveReplies
+    // closes it once they are back
+    if (peerClosed) conn.closing = true;
+
+    if (conn.closing) {
+        // the protocol error reply must come after the replies of the batches still out
+        if (client.inFlight > 0) {
+            if (conn.outBuf.size() > errorAt) {
+                client.pendingError = conn.outBuf.substr(errorAt);
+                conn.outBuf.resize(errorAt);
+            }
+            return true;
+        }
+        sockio::flushWrites(conn);
+        return false;
+    }
+    return true;
+}
+
+void IoServer::closeClient(IoLoop& loop, uint64_t id) {
+    auto it = loop.clients.find(id);
+    if (it == loop.clients.end()) return;
+    int fd = it->second.conn.fd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    // batches still at the executor are dropped when their replies come back
+    loop.clients.erase(it);
+}
+
+bool IoServer::submit(IoLoop& loop) {
+    bool pushed = false;
+    while (!loop.backlog.empty() && requests.push(loop.backlog.front())) {
+        loop.backlog.pop_front();
+        pushed = true;
+    }
+    // only pay for the eventfd write when the executor is about to block
+    if (pushed) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (executorSleeping.load(std::memory_order_relaxed)) wake(executorWakeFd);
+    }
+    return !loop.backlog.empty();
+}
+
+void IoServer::receiveReplies(IoLoop& loop) {
+    Batch* batch;
+    while (loop.replies->pop(batch)) {
+        auto it = loop.clients.find(batch->client);
+        if (it == loop.clients.end()) {
+            delete batch;
+            continue;
+        }
+        Client& client = it->second;
+        Connection& conn = client.conn;
+
+        ReplyWriter::render(batch->reply, conn.outBuf);
+        delete batch;
+
+        client.inFlight--;
+        bool alive = true;
+        if (conn.closing && client.inFlight == 0) {
+            conn.outBuf += client.pendingError;
+            sockio::flushWrites(conn);
+            alive = false;
+        } else if (!conn.writeBlocked) {
+            alive = sockio::flushWrites(conn);
+        }
+        if (!alive) closeClient(loop, it->first);
+    }
+}
+
+// ---------------- executor ----------------
+
+void IoServer::runExecutor() {
+    std::vector<uint8_t> woken(loopCount, 0);
+    std::vector<std::deque<Batch*>> stuck(loopCount);   // reply rings that were full
+    std::vector<std::string_view> argv;
+    bool idlePending = false;
+
+    while (running) {
+        Batch* batch;
+        bool worked = false;
+
+        while (requests.pop(batch)) {
+            worked = true;
+            // the executor only records the results, the i/o thread formats them
+            ReplyWriter out(batch->reply, ReplyWriter::Format::RECORDS);
+            argv.clear();
+            for (auto [offset, length] : batch->args) argv.emplace_back(batch->input.data() + offset, length);
+            parser.processBatch(argv, batch->argc, out);
+
+            uint32_t target = batch->loop;
+            if (!stuck[target].empty() || !loops[target]->replies->push(batch))
+                stuck[target].push_back(batch);
+            woken[target] = 1;
+        }
+
+        bool blocked = false;
+        for (uint32_t i = 0; i < loopCount; i++) {
+            while (!stuck[i].empty() && loops[i]->replies->push(stuck[i].front())) stuck[i].pop_front();
+            blocked |= !stuck[i].empty();
+            if (woken[i]) {
+                woken[i] = 0;
+                wake(loops[i]->wakeFd);
+            }
+        }
+
+        if (worked || blocked) {
+            idlePending = parser.hasIdleWork();
+            continue;
+        }
+        if (idlePending) {
+            idlePending = parser.idleWork();
+            continue;
+        }
+
+        // nothing to do: announce the sleep, check once more and block on the eventfd
+        executorSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!requests.empty()) {
+            executorSleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        pollfd pfd{ executorWakeFd, POLLIN, 0 };
+        poll(&pfd, 1, -1);
+        uint64_t v;
+        while (read(executorWakeFd, &v, sizeof(v)) > 0) {}
+        executorSleeping.store(false, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,192 @@
+// linux backend for the tcp server
+// each thread runs an edge triggered epoll reactor over non blocking sockets
+// every connection owns a read buffer and a write buffer so a slow client never blocks the loop
+
+#include "server/server.hpp"
+#include "server/socket_io.hpp"
+#include "parser/parser.hpp"
+#include "logging/logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static const int MAX_EVENTS = 1024;        // events drained per epoll_wait call
+
+// constructor for tcp server
+// takes port number, a reference to the parser and the number of event loop threads
+TcpServer::TcpServer(int port, Parser& p, int threads)
+    : parser(p), port(port), threadCount(threads < 1 ? 1 : threads), running(false) {}
+
+// destructor for tcp server
+TcpServer::~TcpServer() {
+    stop(); // stop the server gracefully
+
+    for (auto& loop : loops) {
+        for (auto& kv : loop->connections) close(kv.first);
+        if (loop->listenFd != -1) close(loop->listenFd);
+        if (loop->epollFd != -1) close(loop->epollFd);
+        if (loop->wakeFd != -1) close(loop->wakeFd);
+    }
+    loops.clear();
+}
+
+// start the tcp server
+// sets up one event loop per thread and then blocks running the first one until stop() is called
+bool TcpServer::start() {
+    for (int i = 0; i < threadCount; i++) {
+        loops.push_back(std::make_unique<EventLoop>());
+        if (!openLoop(*loops.back())) return false;
+    }
+
+    running = true; // mark the server as running
+    LOG_INFO("Server started on port ", port, " with ", threadCount, " event loop(s)");
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++)
+        workers.emplace_back([this, i] { runLoop(*loops[i]); });
+
+    runLoop(*loops[0]);
+    for (auto& w : workers) w.join();
+
+    return true; // server ran and was stopped
+}
+
+// sets up the listening socket, epoll instance and wake eventfd of one loop
+bool TcpServer::openLoop(EventLoop& loop) {
+    // every loop binds the same port, the kernel balances new connections between them
+    loop.listenFd = sockio::openListener(port, threadCount > 1);
+    if (loop.listenFd == -1) return false;
+
+    loop.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    loop.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.epollFd == -1 || loop.wakeFd == -1) {
+        LOG_ERROR("epoll setup failed: ", std::strerror(errno));
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = loop.listenFd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, loop.listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.fd = loop.wakeFd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, loop.wakeFd, &ev);
+    return true;
+}
+
+// main event loop of one thread
+void TcpServer::runLoop(EventLoop& loop) {
+    epoll_event events[MAX_EVENTS];
+    bool idlePending = false;   // the parser has background work for quiet moments
+
+    while (running) {
+        // with background work pending just poll, so a quiet server keeps making progress on it
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, idlePending ? 0 : -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: ", std::strerror(errno));
+            break;
+        }
+        if (n == 0) {
+            idlePending = parser.idleWork();
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t mask = events[i].events;
+
+            if (fd == loop.listenFd) {
+                acceptClients(loop);
+                continue;
+            }
+            if (fd == loop.wakeFd) {
+                uint64_t v;
+                while (read(loop.wakeFd, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) continue;
+            Connection& conn = it->second;
+
+            bool alive = !(mask & EPOLLERR);
+            // read first so a request that arrives together with a hangup is still answered
+            if (alive && (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) alive = handleRead(conn);
+            if (alive && (mask & EPOLLOUT)) {
+                conn.writeBlocked = false;
+                alive = sockio::flushWrites(conn);
+                // a closing client is let go once the last of its replies went out
+                if (alive && conn.closing && !conn.writeBlocked) alive = false;
+            }
+
+            if (!alive) closeConnection(loop, fd);
+        }
+
+        idlePending = parser.hasIdleWork();
+    }
+}
+
+// stop the tcp server
+// safe to call from another thread, the eventfds wake every loop so it can notice the flag
+void TcpServer::stop() {
+    if (!running) return; // if server not running, do nothing
+
+    running = false; // mark server as stopped
+    for (auto& loop : loops) {
+        if (loop->wakeFd == -1) continue;
+        uint64_t one = 1;
+        ssize_t ignored = write(loop->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    LOG_INFO("Server stopped.");
+}
+
+// accept every pending client, edge triggered mode only reports the listen socket once
+void TcpServer::acceptClients(EventLoop& loop) {
+    int fd;
+    while ((fd = sockio::acceptClient(loop.listenFd)) != -1) {
+        // register for both directions once, edge triggering means EPOLLOUT only fires
+        // when the socket goes from full to writable so there is no busy wakeup
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            continue;
+        }
+
+        Connection& conn = loop.connections[fd];
+        conn.fd = fd;
+    }
+}
+
+// drain the socket until it would block and then run the requests that were received
+bool TcpServer::handleRead(Connection& conn) {
+    bool peerClosed = false;
+    if (!sockio::readAvailable(conn, peerClosed)) return false;
+
+    // run the whole pipelined batch first, then answer it with a single send
+    // a partial request at the end stays buffered until the rest of it arrives
+    conn.executePending(parser);
+    // a half closed client still gets the replies to everything it sent
+    if (peerClosed) conn.closing = true;
+
+    // while the socket is full the replies just queue up, EPOLLOUT will flush them. a closing
+    // connection (eof or protocol error) stays registered until they are all sent
+    if (!conn.writeBlocked && !sockio::flushWrites(conn)) return false;
+    return !(conn.closing && !conn.writeBlocked);
+}
+
+// unregister and release a client
+void TcpServer::closeConnection(EventLoop& loop, int fd) {
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    loop.connections.erase(fd);
+}
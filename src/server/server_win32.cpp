@@ -1,6 +1,9 @@
+// windows backend for the tcp server
+// one thread is created per accepted client
+
 #include "server/server.hpp"
 #include "parser/parser.hpp"
-#include <iostream>
+#include "logging/logger.hpp"
 
 // structure to pass parameters to the client thread
 struct ClientParam {
@@ -10,16 +13,14 @@ struct ClientParam {
 
 // constructor for tcp server
 // takes port number and a reference to the parser
-TcpServer::TcpServer(int port, Parser& p)
-    : port(port), serverSocket(INVALID_SOCKET), running(false), parser(p) 
+TcpServer::TcpServer(int port, Parser& p, int threads)
+    : parser(p), port(port), threadCount(threads), running(false), serverSocket(INVALID_SOCKET)
 {
-    InitializeCriticalSection(&cs); // initialize critical section for thread safety
 }
 
 // destructor for tcp server
 TcpServer::~TcpServer() {
     stop(); // stop the server gracefully
-    DeleteCriticalSection(&cs); // delete the critical section
 }
 
 // start the tcp server
@@ -27,14 +28,14 @@ bool TcpServer::start() {
     WSADATA wsa;
     // initialize winsock
     if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) {
-        std::cerr << "WSAStartup failed\n";
+        LOG_ERROR("WSAStartup failed");
         return false; // if fails, return false
     }
 
     // create a tcp socket
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocket == INVALID_SOCKET) {
-        std::cerr << "Socket creation failed\n";
+        LOG_ERROR("Socket creation failed");
         WSACleanup();
         return false;
     }
@@ -47,7 +48,7 @@ bool TcpServer::start() {
 
     // bind the socket to the address and port
     if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "Bind failed\n";
+        LOG_ERROR("Bind failed");
         closesocket(serverSocket);
         WSACleanup();
         return false;
@@ -55,14 +56,14 @@ bool TcpServer::start() {
 
     // start listening for incoming connections
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-        std::cerr << "Listen failed\n";
+        LOG_ERROR("Listen failed");
         closesocket(serverSocket);
         WSACleanup();
         return false;
     }
 
     running = true; // mark the server as running
-    std::cout << "Server started on port " << port << "\n";
+    LOG_INFO("Server started on port ", port);
 
     // main server loop to accept incoming clients
     while (running) {
@@ -72,7 +73,7 @@ bool TcpServer::start() {
         SOCKET clientSock = accept(serverSocket, (sockaddr*)&clientAddr, &addrSize);
         if (clientSock == INVALID_SOCKET) {
             if (!running) break; // if server stopped exit loop
-            std::cerr << "Accept failed\n";
+            LOG_ERROR("Accept failed");
             continue; // continue to next iteration
         }
 
@@ -100,7 +101,7 @@ void TcpServer::stop() {
     }
 
     WSACleanup(); // cleanup winsock resources
-    std::cout << "Server stopped.\n";
+    LOG_INFO("Server stopped.");
 }
 
 // static function for client thread
@@ -118,19 +119,25 @@ DWORD WINAPI TcpServer::clientThread(LPVOID param) {
 void TcpServer::handleClient(SOCKET clientSocket) {
     char buffer[4096]; // buffer to store received data
     int bytesRecv;
+    Connection conn;   // request framing state for this client
 
     while (running) {
-        ZeroMemory(buffer, 4096); // clear buffer
         bytesRecv = recv(clientSocket, buffer, 4096, 0); // receive data from client
         if (bytesRecv <= 0) break; // if client disconnects or error break loop
 
-        std::string received(buffer, bytesRecv); // convert buffer to string
+        conn.inBuf.append(buffer, bytesRecv);
 
-        // call parser to process received data
-        std::string response = parser.route(received);
+        // run every complete request in the batch and send all replies back in one go
+        conn.executePending(parser);
 
-        // send the response back to the client
-        send(clientSocket, response.c_str(), (int)response.size(), 0);
+        bool sendFailed = false;
+        while (conn.outPos < conn.outBuf.size()) {
+            int sent = send(clientSocket, conn.outBuf.data() + conn.outPos,
+                            (int)(conn.outBuf.size() - conn.outPos), 0);
+            if (sent == SOCKET_ERROR) { sendFailed = true; break; }
+            conn.outPos += sent;
+        }
+        if (sendFailed || conn.closing) break;
     }
 
     closesocket(clientSocket); // close the client socket when done
@@ -0,0 +1,105 @@
+#include "server/socket_io.hpp"
+#include "logging/logger.hpp"
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace sockio {
+
+static const size_t READ_CHUNK = 16384;    // bytes requested per recv call
+
+int openListener(int port, bool reusePort) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        LOG_ERROR("Socket creation failed: ", std::strerror(errno));
+        return -1;
+    }
+
+    // allow quick restarts while old connections sit in TIME_WAIT
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (reusePort) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+
+    // set up the server address structure
+    sockaddr_in serverAddr{};
+    serverAddr.sin_family = AF_INET; // ipv4
+    serverAddr.sin_port = htons(port); // convert port to network byte order
+    serverAddr.sin_addr.s_addr = INADDR_ANY; // listen on all interfaces
+
+    if (bind(fd, (sockaddr*)&serverAddr, sizeof(serverAddr)) == -1) {
+        LOG_ERROR("Bind failed: ", std::strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, SOMAXCONN) == -1) {
+        LOG_ERROR("Listen failed: ", std::strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int acceptClient(int listenFd) {
+    while (true) {
+        sockaddr_in clientAddr;
+        socklen_t addrSize = sizeof(clientAddr);
+        int fd = accept4(listenFd, (sockaddr*)&clientAddr, &addrSize, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_ERROR("Accept failed: ", std::strerror(errno));
+            return -1;
+        }
+
+        // replies are small, do not let nagle hold them back
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        return fd;
+    }
+}
+
+bool readAvailable(Connection& conn, bool& peerClosed) {
+    peerClosed = false;
+    while (true) {
+        size_t oldSize = conn.inBuf.size();
+        conn.inBuf.resize(oldSize + READ_CHUNK);
+        ssize_t r = recv(conn.fd, &conn.inBuf[oldSize], READ_CHUNK, 0);
+        conn.inBuf.resize(oldSize + (r > 0 ? (size_t)r : 0));
+
+        if (r > 0) continue;
+        if (r == 0) { peerClosed = true; return true; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        return false; // hard socket error
+    }
+}
+
+bool flushWrites(Connection& conn) {
+    while (conn.outPos < conn.outBuf.size()) {
+        ssize_t w = send(conn.fd, conn.outBuf.data() + conn.outPos,
+                         conn.outBuf.size() - conn.outPos, MSG_NOSIGNAL);
+        if (w > 0) {
+            conn.outPos += (size_t)w;
+            continue;
+        }
+        if (w == -1 && errno == EINTR) continue;
+        if (w == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            conn.writeBlocked = true;
+            return true;
+        }
+        return false;
+    }
+
+    // everything written, reuse the buffer capacity for the next replies
+    conn.outBuf.clear();
+    conn.outPos = 0;
+    conn.writeBlocked = false;
+    return true;
+}
+
+} // namespace sockio
@@ -0,0 +1,72 @@
+#include "storage/ChainedTable.hpp"
+
+ChainedTable::ChainedTable(size_t capacity) {
+    if (capacity == 0) return;   // placeholder, RedisHashMap only probes tables it has sized
+    size_t n = 16;
+    while (n < capacity) n <<= 1;
+    buckets.resize(n);
+}
+
+HashEntry* ChainedTable::find(std::string_view key, KeyHash hash) {
+    auto& bucket = buckets[bucketOf(hash)];
+    for (auto& entry : bucket) {
+        if (entry.matches(key, hash)) return &entry;
+    }
+    return nullptr;
+}
+
+HashEntry* ChainedTable::insert(std::string_view key, RedisObject&& value, KeyHash hash) {
+    auto& bucket = buckets[bucketOf(hash)];
+    bucket.emplace_back(key, hash, std::move(value));
+    count++;
+    return &bucket.back();
+}
+
+// order inside a bucket does not matter, so removal swaps the last entry into the hole
+bool ChainedTable::erase(std::string_view key, KeyHash hash) {
+    auto& bucket = buckets[bucketOf(hash)];
+    for (auto& entry : bucket) {
+        if (!entry.matches(key, hash)) continue;
+        if (&entry != &bucket.back()) entry = std::move(bucket.back());
+        bucket.pop_back();
+        // an emptied bucket frees its storage now while it is in cache, not all at once when
+        // a shrink drops the table
+        if (bucket.empty()) std::vector<HashEntry>().swap(bucket);
+        count--;
+        return true;
+    }
+    return false;
+}
+
+// entries are moved, not copied, so the strings, lists and hashes they own are never cloned
+// and the stored hash places them without hashing the key again
+size_t ChainedTable::migrate(size_t unit, ChainedTable& dest) {
+    auto& bucket = buckets[unit];
+    size_t moved = bucket.size();
+    if (moved == 0) return 0;
+    dest.count += moved;
+    count -= moved;
+
+    // when everything lands in one bucket that is still empty the vector itself is handed over,
+    // no allocation. shrinking maps whole buckets, the entries are not even read, which matters
+    // as the old table is cold by the time it drains
+    bool folds = dest.buckets.size() <= buckets.size();
+    size_t target = folds ? unit & (dest.buckets.size() - 1) : dest.bucketOf(bucket[0].hash);
+    bool together = dest.buckets[target].empty();
+    for (size_t i = 1; !folds && together && i < moved; i++)
+        together = dest.bucketOf(bucket[i].hash) == target;
+    if (together) {
+        dest.buckets[target].swap(bucket);
+        return moved;
+    }
+
+    for (auto& entry : bucket)
+        dest.buckets[dest.bucketOf(entry.hash)].push_back(std::move(entry));
+    // give the memory back right away so the old table shrinks while it drains
+    std::vector<HashEntry>().swap(bucket);
+    return moved;
+}
+
+void ChainedTable::scanUnit(size_t unit, std::vector<const HashEntry*>& out) const {
+    for (const auto& entry : buckets[unit]) out.push_back(&entry);
+}
@@ -0,0 +1,115 @@
+#include "storage/IntSet.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INTSET_SSE2 1
+#endif
+
+// the binary search stops at this many candidates, the rest is one linear pass
+static const size_t LINEAR_WINDOW = 32;
+
+template <typename T>
+static bool fits(int64_t v) {
+    return v >= std::numeric_limits<T>::min() && v <= std::numeric_limits<T>::max();
+}
+
+// true when one of the n values at p is v, compared 16 bytes at a time. sse2 has no 64 bit
+// compare: those are compared as 32 bit halves and a lane only matches when both halves do
+template <typename T>
+static bool anyEqual(const T* p, size_t n, T v) {
+    size_t i = 0;
+#ifdef INTSET_SSE2
+    constexpr size_t lanes = 16 / sizeof(T);
+    __m128i needle;
+    if constexpr (sizeof(T) == 2) needle = _mm_set1_epi16((short)v);
+    else if constexpr (sizeof(T) == 4) needle = _mm_set1_epi32((int)v);
+    else needle = _mm_set1_epi64x((long long)v);
+    for (; i + lanes <= n; i += lanes) {
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i eq;
+        if constexpr (sizeof(T) == 2) {
+            eq = _mm_cmpeq_epi16(group, needle);
+        } else {
+            eq = _mm_cmpeq_epi32(group, needle);
+            if constexpr (sizeof(T) == 8) eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        }
+        if (_mm_movemask_epi8(eq)) return true;
+    }
+#endif
+    for (; i < n; i++)
+        if (p[i] == v) return true;
+    return false;
+}
+
+uint8_t IntSet::widthFor(int64_t v) {
+    if (fits<int16_t>(v)) return 2;
+    if (fits<int32_t>(v)) return 4;
+    return 8;
+}
+
+bool IntSet::contains(int64_t v) const {
+    if (widthFor(v) > width) return false;
+    return withMembers([&](auto vec) {
+        using T = typename decltype(vec)::value_type;
+        // v, if it is there, stays inside [lo, hi)
+        size_t lo = 0, hi = vec.size();
+        while (hi - lo > LINEAR_WINDOW) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (vec[mid] < (T)v) lo = mid + 1;
+            else hi = mid + 1;
+        }
+        return anyEqual(vec.data() + lo, hi - lo, (T)v);
+    });
+}
+
+template <typename T>
+bool IntSet::insertAs(int64_t v) {
+    T* first = members<T>();
+    T* last = first + count;
+    T* it = std::lower_bound(first, last, (T)v);
+    if (it != last && *it == (T)v) return false;
+    std::memmove(it + 1, it, (size_t)(last - it) * sizeof(T));
+    *it = (T)v;
+    count++;
+    return true;
+}
+
+template <typename T>
+bool IntSet::eraseAs(int64_t v) {
+    T* first = members<T>();
+    T* last = first + count;
+    T* it = std::lower_bound(first, last, (T)v);
+    if (it == last || *it != (T)v) return false;
+    std::memmove(it, it + 1, (size_t)(last - it - 1) * sizeof(T));
+    count--;
+    return true;
+}
+
+bool IntSet::insert(int64_t v) {
+    if (width == 2) return insertAs<int16_t>(v);
+    if (width == 4) return insertAs<int32_t>(v);
+    return insertAs<int64_t>(v);
+}
+
+bool IntSet::erase(int64_t v) {
+    if (widthFor(v) > width) return false;
+    if (width == 2) return eraseAs<int16_t>(v);
+    if (width == 4) return eraseAs<int32_t>(v);
+    return eraseAs<int64_t>(v);
+}
+
+int64_t IntSet::at(size_t i) const {
+    return withMembers([&](auto vec) { return (int64_t)vec[i]; });
+}
+
+void IntSet::copyFrom(const IntSet& other) {
+    other.withMembers([&](auto vec) {
+        if (width == 2) std::copy(vec.begin(), vec.end(), members<int16_t>());
+        else if (width == 4) std::copy(vec.begin(), vec.end(), members<int32_t>());
+        else std::copy(vec.begin(), vec.end(), members<int64_t>());
+    });
+    count = other.count;
+}
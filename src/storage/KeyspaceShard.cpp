@@ -0,0 +1,216 @@
+#include "storage/KeyspaceShard.hpp"
+#include "logging/logger.hpp"
+#include <algorithm>
+#include <utility>
+
+// buckets moved to the new table by every write while a rehash is running
+static const size_t REHASH_STEP = 4;
+// buckets moved per step when a full table forces the migration to finish
+static const size_t REHASH_BATCH = 128;
+
+KeyspaceShard::KeyspaceShard(size_t id, size_t capacity)
+    : id(id) {
+    tables[0] = KeyTable(capacity);
+    minCapacity = tables[0].capacity();
+}
+
+// allocate the bigger table, the entries move over a few buckets at a time
+void KeyspaceShard::startRehash(size_t newCapacity) {
+    LOG_INFO("RESIZE operation started - Shard: ", id, ", Old capacity: ", tables[0].capacity(),
+             ", New capacity: ", newCapacity, ", Current entries: ", count);
+
+    tables[1] = KeyTable(newCapacity);
+    rehashIdx = 0;
+    rehashing.store(true, std::memory_order_relaxed);
+}
+
+// the old table is empty, the new one takes its place
+void KeyspaceShard::finishRehash() {
+    tables[0] = std::move(tables[1]);
+    tables[1] = KeyTable();
+    rehashing.store(false, std::memory_order_relaxed);
+
+    float newLoadFactor = (float)count / (float)tables[0].capacity();
+    LOG_INFO("RESIZE completed - Shard: ", id, ", New capacity: ", tables[0].capacity(),
+             ", New load factor: ", newLoadFactor);
+}
+
+// shrinks to at most 2/3 of the grow threshold, so a few inserts right after can not grow it back,
+// and usually by more than half so a table that keeps emptying out is not rebuilt at every halving
+size_t KeyspaceShard::shrinkTarget() const {
+    if (isRehashing() || !tables[0].underloaded()) return 0;
+    size_t target = std::max(minCapacity, KeyTable::capacityFor(count + count / 2));
+    if (target * 2 > tables[0].capacity()) return 0;   // not worth a migration for less than half
+    return target;
+}
+
+void KeyspaceShard::noteErase() {
+    if (!wantsShrink() && shrinkTarget())
+        shrinkWanted.store(true, std::memory_order_relaxed);
+}
+
+void KeyspaceShard::shrinkIfSparse() {
+    shrinkWanted.store(false, std::memory_order_relaxed);
+    if (size_t target = shrinkTarget()) startRehash(target);
+}
+
+void KeyspaceShard::reserve(size_t keys) {
+    size_t target = KeyTable::capacityFor(keys);
+    minCapacity = std::max(minCapacity, target);
+    if (target <= capacity() && !isRehashing()) return;
+
+    // an empty shard just swaps its table, otherwise a running resize is finished first and the
+    // keys move over incrementally like for any other growth
+    if (count == 0) {
+        tables[0] = KeyTable(std::max(target, capacity()));
+        tables[1] = KeyTable();
+        rehashing.store(false, std::memory_order_relaxed);
+        return;
+    }
+    while (rehashStep(REHASH_BATCH)) {}
+    if (target > capacity()) startRehash(target);
+}
+
+bool KeyspaceShard::rehashStep(size_t n) {
+    if (!isRehashing()) return false;
+
+    // empty buckets are cheap but still bounded, a sparse table must not turn one step into a scan
+    size_t emptyVisits = n * 10;
+    KeyTable& old = tables[0];
+    size_t units = old.migrationUnits();
+    while (n > 0 && rehashIdx < units && old.size() > 0) {
+        size_t moved = old.migrate(rehashIdx, tables[1]);
+        rehashIdx++;
+        if (moved) {
+            n--;
+        } else if (--emptyVisits == 0) {
+            break;
+        }
+    }
+
+    if (rehashIdx >= units || old.size() == 0) {
+        finishRehash();
+        return false;
+    }
+    return true;
+}
+
+// lookup in both tables, the migrated part of tables[0] is already empty
+HashEntry* KeyspaceShard::findEntry(std::string_view key, KeyHash hash, int* tableOut) {
+    for (int t = 0; t < 2; t++) {
+        if (HashEntry* entry = tables[t].find(key, hash)) {
+            if (tableOut) *tableOut = t;
+            return entry;
+        }
+        if (!isRehashing()) break;
+    }
+    return nullptr;
+}
+
+// no rehash step here, a read must not move entries under pointers the caller already holds
+HashEntry* KeyspaceShard::find(std::string_view key, KeyHash hash) {
+    return findEntry(key, hash);
+}
+
+void KeyspaceShard::prefetchBucket(KeyHash hash) const {
+    tables[0].prefetchBucket(hash);
+    if (isRehashing()) tables[1].prefetchBucket(hash);
+}
+
+void KeyspaceShard::prefetchEntries(KeyHash hash) const {
+    tables[0].prefetchEntries(hash);
+    if (isRehashing()) tables[1].prefetchEntries(hash);
+}
+
+// every write moves a few buckets along, an overwrite once it is done with the entry
+bool KeyspaceShard::insert(std::string_view key, RedisObject&& value, KeyHash hash) {
+    // replace if key exists
+    if (HashEntry* entry = findEntry(key, hash)) {
+        entry->value = std::move(value);
+        if (isRehashing()) rehashStep(REHASH_STEP);
+        return false;
+    }
+    insertNew(key, std::move(value), hash);
+    return true;
+}
+
+HashEntry* KeyspaceShard::insertNew(std::string_view key, RedisObject&& value, KeyHash hash) {
+    if (isRehashing()) rehashStep(REHASH_STEP);
+
+    // the new table filled up before the old one drained, finish the migration first
+    if (isRehashing() && tables[1].overloaded()) {
+        while (rehashStep(REHASH_BATCH)) {}
+    }
+
+    // while rehashing new keys go straight to the new table so the old one only drains
+    KeyTable& table = isRehashing() ? tables[1] : tables[0];
+    HashEntry* entry = table.insert(key, std::move(value), hash);
+    count++;
+
+    // check load factor, starting a rehash only allocates, the entry stays where it is
+    if (!isRehashing() && table.overloaded()) {
+        LOG_DEBUG("ADD - Load factor exceeded on shard ", id, ", starting rehash");
+        startRehash(table.grownCapacity());
+    }
+    return entry;
+}
+
+bool KeyspaceShard::erase(std::string_view key, KeyHash hash) {
+    if (isRehashing()) rehashStep(REHASH_STEP);
+
+    bool erased = tables[0].erase(key, hash) || (isRehashing() && tables[1].erase(key, hash));
+    if (erased) {
+        count--;
+        noteErase();
+    }
+    return erased;
+}
+
+std::optional<RedisObject> KeyspaceShard::extract(std::string_view key, KeyHash hash) {
+    if (isRehashing()) rehashStep(REHASH_STEP);
+
+    int table = 0;
+    HashEntry* entry = findEntry(key, hash, &table);
+    if (!entry) return std::nullopt;
+
+    std::optional<RedisObject> value(std::move(entry->value));
+    tables[table].erase(key, hash);
+    count--;
+    noteErase();
+    return value;
+}
+
+static uint64_t reverseBits(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+    v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+    v = ((v >> 8) & 0x00FF00FF00FF00FFull) | ((v & 0x00FF00FF00FF00FFull) << 8);
+    v = ((v >> 16) & 0x0000FFFF0000FFFFull) | ((v & 0x0000FFFF0000FFFFull) << 16);
+    return (v >> 32) | (v << 32);
+}
+
+uint64_t KeyspaceShard::scan(uint64_t cursor, std::vector<const HashEntry*>& out) const {
+    const KeyTable* small = &tables[0];
+    const KeyTable* large = nullptr;
+    if (isRehashing()) {
+        large = &tables[1];
+        if (small->scanUnits() > large->scanUnits()) std::swap(small, large);
+    }
+
+    uint64_t m0 = small->scanUnits() - 1;
+    small->scanUnit(cursor & m0, out);
+    if (large) {
+        // every bucket of the larger table whose low bits are the small table's bucket
+        uint64_t m1 = large->scanUnits() - 1;
+        do {
+            large->scanUnit(cursor & m1, out);
+            cursor = (((cursor | m0) + 1) & ~m0) | (cursor & m0);
+        } while (cursor & (m0 ^ m1));
+    }
+
+    // add one to the reversed bits of the small table's part
+    cursor |= ~m0;
+    cursor = reverseBits(cursor);
+    cursor++;
+    return reverseBits(cursor);
+}
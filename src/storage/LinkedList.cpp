@@ -12,7 +12,7 @@ LinkedList::~LinkedList() {
 }
 // dual push
 // push front 
-void LinkedList::push_front(const std::string& val) {
+void LinkedList::push_front(std::string_view val) {
     ListNode* node = new ListNode(val);
     if (!head) {
         head = tail = node;
@@ -25,7 +25,7 @@ void LinkedList::push_front(const std::string& val) {
 }
 
 // push back
-void LinkedList::push_back(const std::string& val) {
+void LinkedList::push_back(std::string_view val) {
     ListNode* node = new ListNode(val);
     if (!tail) {
         head = tail = node;
@@ -81,7 +81,7 @@ std::string LinkedList::get(long long index) const {
 }
 
 // index set
-void LinkedList::set(long long index, const std::string& val) {
+void LinkedList::set(long long index, std::string_view val) {
     if (index < 0) index += size;
     if (index < 0 || index >= (long long)size)
         throw std::out_of_range("index out of range");
@@ -154,13 +154,19 @@ void LinkedList::sort(bool ascending) {
 }
 
 
+// copy constructor
+LinkedList::LinkedList(const LinkedList& other) : LinkedList() {
+    for (ListNode* curr = other.head; curr; curr = curr->next) push_back(curr->value);
+}
+
+// move constructor
+LinkedList::LinkedList(LinkedList&& other) noexcept
+    : head(other.head), tail(other.tail), size(other.size) {
+    other.head = other.tail = nullptr;
+    other.size = 0;
+}
+
 // clone
 LinkedList* LinkedList::clone() const {
-    LinkedList* copy = new LinkedList();
-    ListNode* curr = head;
-    while (curr) {
-        copy->push_back(curr->value);
-        curr = curr->next;
-    }
-    return copy;
+    return new LinkedList(*this);
 }
\ No newline at end of file
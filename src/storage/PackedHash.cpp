@@ -0,0 +1,55 @@
+#include "storage/PackedHash.hpp"
+#include <cstring>
+
+PackedHash::Entry PackedHash::at(size_t pos) const {
+    size_t fieldLen = (uint8_t)buf[pos];
+    size_t valuePos = pos + 1 + fieldLen;
+    size_t valueLen = (uint8_t)buf[valuePos];
+    return { std::string_view(buf.data() + pos + 1, fieldLen),
+             std::string_view(buf.data() + valuePos + 1, valueLen),
+             valuePos + 1 + valueLen };
+}
+
+// the length byte is checked before the bytes, most fields are skipped without a compare
+size_t PackedHash::find(std::string_view field) const {
+    for (size_t pos = 0; pos < buf.size();) {
+        size_t fieldLen = (uint8_t)buf[pos];
+        if (fieldLen == field.size() && std::memcmp(buf.data() + pos + 1, field.data(), fieldLen) == 0)
+            return pos;
+        size_t valuePos = pos + 1 + fieldLen;
+        pos = valuePos + 1 + (uint8_t)buf[valuePos];
+    }
+    return NPOS;
+}
+
+std::optional<std::string_view> PackedHash::get(std::string_view field) const {
+    size_t pos = find(field);
+    if (pos == NPOS) return std::nullopt;
+    return at(pos).value;
+}
+
+// a new field goes at the end, an overwrite replaces the value where it is
+bool PackedHash::set(std::string_view field, std::string_view value) {
+    size_t pos = find(field);
+    if (pos == NPOS) {
+        buf.push_back((char)(uint8_t)field.size());
+        buf.append(field);
+        buf.push_back((char)(uint8_t)value.size());
+        buf.append(value);
+        count++;
+        return true;
+    }
+    Entry e = at(pos);
+    size_t valuePos = pos + 1 + e.field.size();
+    buf[valuePos] = (char)(uint8_t)value.size();
+    buf.replace(valuePos + 1, e.value.size(), value);
+    return false;
+}
+
+bool PackedHash::erase(std::string_view field) {
+    size_t pos = find(field);
+    if (pos == NPOS) return false;
+    buf.erase(pos, at(pos).end - pos);
+    count--;
+    return true;
+}
@@ -0,0 +1,109 @@
+#include "storage/ReadIndex.hpp"
+#include "concurrency/epoch.hpp"
+
+// marks a deleted slot, probes go past it
+static ReadSnapshot tombstoneNode;
+static ReadSnapshot* const TOMBSTONE = &tombstoneNode;
+
+ReadSnapshot::ReadSnapshot(std::string_view key, KeyHash hash, const RedisObject& value)
+    : key(key), hash(hash), type(value.getType()) {
+    if (type == RedisType::STRING || type == RedisType::HASH) this->value = value;
+}
+
+ReadIndex::Slots::Slots(size_t capacity)
+    : mask(capacity - 1), slot(new std::atomic<ReadSnapshot*>[capacity]) {
+    for (size_t i = 0; i < capacity; i++) slot[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ReadIndex::Slots::~Slots() {
+    delete[] slot;
+}
+
+ReadIndex::ReadIndex(size_t capacity) {
+    size_t n = 16;
+    while (n < capacity) n <<= 1;
+    current.store(new Slots(n), std::memory_order_relaxed);
+}
+
+// nobody can be reading any more, everything still linked is freed directly
+ReadIndex::~ReadIndex() {
+    Slots* s = current.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= s->mask; i++) {
+        ReadSnapshot* snap = s->slot[i].load(std::memory_order_relaxed);
+        if (snap && snap != TOMBSTONE) delete snap;
+    }
+    delete s;
+}
+
+const ReadSnapshot* ReadIndex::find(std::string_view key, KeyHash hash) const {
+    const Slots* s = current.load(std::memory_order_acquire);
+    for (size_t i = hash & s->mask;; i = (i + 1) & s->mask) {
+        const ReadSnapshot* snap = s->slot[i].load(std::memory_order_acquire);
+        if (!snap) return nullptr;
+        if (snap != TOMBSTONE && snap->hash == hash && snap->key == key) return snap;
+    }
+}
+
+void ReadIndex::publish(ReadSnapshot* snap) {
+    // keep at most half of the slots used so probes stay short and always end on an empty slot
+    if ((used + 1) * 2 > current.load(std::memory_order_relaxed)->mask + 1) grow();
+
+    Slots* s = current.load(std::memory_order_relaxed);
+    size_t reuse = SIZE_MAX;
+    for (size_t i = snap->hash & s->mask;; i = (i + 1) & s->mask) {
+        ReadSnapshot* old = s->slot[i].load(std::memory_order_relaxed);
+        if (old == TOMBSTONE) {
+            if (reuse == SIZE_MAX) reuse = i;
+            continue;
+        }
+        if (!old) {
+            // not present, take the first tombstone on the way if there was one
+            if (reuse == SIZE_MAX) {
+                reuse = i;
+                used++;
+            }
+            s->slot[reuse].store(snap, std::memory_order_release);
+            live++;
+            return;
+        }
+        if (old->hash == snap->hash && old->key == snap->key) {
+            s->slot[i].store(snap, std::memory_order_release);
+            epoch::retire(old);
+            return;
+        }
+    }
+}
+
+void ReadIndex::remove(std::string_view key, KeyHash hash) {
+    Slots* s = current.load(std::memory_order_relaxed);
+    for (size_t i = hash & s->mask;; i = (i + 1) & s->mask) {
+        ReadSnapshot* old = s->slot[i].load(std::memory_order_relaxed);
+        if (!old) return;
+        if (old != TOMBSTONE && old->hash == hash && old->key == key) {
+            s->slot[i].store(TOMBSTONE, std::memory_order_release);
+            live--;
+            epoch::retire(old);
+            return;
+        }
+    }
+}
+
+// builds a bigger array without the tombstones, readers still in the old one are fine because
+// the snapshots are shared and the old array is only freed once they are gone
+void ReadIndex::grow() {
+    Slots* old = current.load(std::memory_order_relaxed);
+    size_t n = 16;
+    while (n < (live + 1) * 4) n <<= 1;
+
+    Slots* next = new Slots(n);
+    for (size_t i = 0; i <= old->mask; i++) {
+        ReadSnapshot* snap = old->slot[i].load(std::memory_order_relaxed);
+        if (!snap || snap == TOMBSTONE) continue;
+        size_t j = snap->hash & next->mask;
+        while (next->slot[j].load(std::memory_order_relaxed)) j = (j + 1) & next->mask;
+        next->slot[j].store(snap, std::memory_order_relaxed);
+    }
+    used = live;
+    current.store(next, std::memory_order_release);
+    epoch::retire(old);
+}
@@ -1,197 +1,280 @@
 #include "storage/RedisHashMap.hpp"
-#include <iostream>
-#include <chrono>
+#include "logging/logger.hpp"
+#include <bit>
+#include <mutex>
+#include <optional>
 
-// timestamp utility
-std::string getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buffer[20];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&time));
-    return buffer;
-}
+// buckets moved per shard visit while the server is idle
+static const size_t REHASH_IDLE_BATCH = 128;
 
 // cosntructor
-RedisHashMap::RedisHashMap(size_t size)
-    : capacity(size)
-{
-    buckets.resize(capacity);
-    std::cout << "[" << getTimestamp() << "] [INFO] RedisHashMap initialized - Capacity: " 
-              << capacity << ", Load factor: " << loadFactor << std::endl;
-}
-
-// computing the bucket index
-size_t RedisHashMap::getIndex(const std::string& key) const {
-    uint32_t hash = MurmurHash3_x86_32(key);
-    return hash % capacity;
-}
-
-// method to resize the hashmap
-void RedisHashMap::resize(size_t newCapacity) {
-    std::cout << "[" << getTimestamp() << "] [INFO] RESIZE operation started - Old capacity: " 
-              << capacity << ", New capacity: " << newCapacity << ", Current entries: " << count << std::endl;
-    
-    std::vector<std::vector<HashEntry>> newBuckets;
-    newBuckets.resize(newCapacity);
-
-    // new bucket table and rehashing 
-    for (auto& bucket : buckets) {
-        for (auto& entry : bucket) {
-            uint32_t hash = MurmurHash3_x86_32(entry.key);
-            size_t newIdx = hash % newCapacity;
-            newBuckets[newIdx].emplace_back(entry.key, entry.value);
-        }
+RedisHashMap::RedisHashMap(size_t size, size_t shardCount) {
+    // round the shard count to a power of two in [1, MAX_SHARDS]
+    size_t n = 1;
+    while (n < shardCount && n < MAX_SHARDS) {
+        n <<= 1;
+        shardBits++;
     }
 
-    buckets.swap(newBuckets);
-    capacity = newCapacity;
-    
-    float newLoadFactor = (float)count / (float)capacity;
-    std::cout << "[" << getTimestamp() << "] [INFO] RESIZE completed - New capacity: " 
-              << capacity << ", New load factor: " << newLoadFactor << std::endl;
+    size_t perShard = std::max<size_t>(size / n, 16);
+    shards.reserve(n);
+    for (size_t i = 0; i < n; i++) shards.push_back(std::make_unique<KeyspaceShard>(i, perShard));
+
+    LOG_INFO("RedisHashMap initialized - Shards: ", n, ", Capacity per shard: ",
+             shards[0]->capacity());
 }
 
+void RedisHashMap::reserve(size_t keys) {
+    // keys spread evenly up to a fraction of a percent, 1/16 headroom keeps a shard that got a
+    // few more than its share from resizing anyway
+    size_t perShard = keys / shards.size();
+    perShard += perShard / 16 + 1;
+    for (auto& s : shards) s->reserve(perShard);
+    LOG_INFO("RedisHashMap reserved for ", keys, " keys - Capacity per shard: ", shards[0]->capacity());
+}
 
-// insert
-bool RedisHashMap::add(const std::string& key, const RedisObject& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] ADD operation - Key: " << key 
-              << ", Current entries: " << count << std::endl;
-    
-    size_t idx = getIndex(key);
-    auto& bucket = buckets[idx];
-
-    // replace if key exists
-    for (auto& entry : bucket) {
-        if (entry.key == key) {
-            entry.value = value;
-            std::cout << "[" << getTimestamp() << "] [INFO] ADD - Key updated (already existed): " 
-                      << key << ", Bucket index: " << idx << std::endl;
-            return true;
-        }
+size_t RedisHashMap::capacity() const {
+    size_t total = 0;
+    for (auto& s : shards) total += s->capacity();
+    return total;
+}
+
+RedisHashMap::ShardGuard::ShardGuard(RedisHashMap& map, uint64_t mask, bool exclusive)
+    : map(map), mask(mask), exclusive(exclusive) {
+    for (uint64_t m = mask; m; m &= m - 1) {
+        auto& lock = map.shards[std::countr_zero(m)]->lock;
+        if (exclusive) lock.lock();
+        else lock.lock_shared();
     }
+}
 
-    bucket.emplace_back(key, value);
-    count++;
-    float currentLoadFactor = (float)count / (float)capacity;
-    
-    std::cout << "[" << getTimestamp() << "] [INFO] ADD - New key inserted: " << key 
-              << ", Bucket index: " << idx << ", Total entries: " << count 
-              << ", Load factor: " << currentLoadFactor << std::endl;
-
-    // check load factor
-    if (currentLoadFactor > loadFactor) {
-        std::cout << "[" << getTimestamp() << "] [WARN] ADD - Load factor exceeded (" 
-                  << currentLoadFactor << "), triggering resize..." << std::endl;
-        resize(capacity * 2);     // double the size
+RedisHashMap::ShardGuard::~ShardGuard() {
+    for (uint64_t m = mask; m; m &= m - 1) {
+        auto& lock = map.shards[std::countr_zero(m)]->lock;
+        if (exclusive) lock.unlock();
+        else lock.unlock_shared();
     }
+}
+
+// insert
+bool RedisHashMap::add(std::string_view key, const RedisObject& value) {
+    return add(key, RedisObject(value));
+}
+
+bool RedisHashMap::add(std::string_view key, RedisObject&& value) {
+    KeyHash hash = hashKey(key);
+    bool inserted = shard(hash).insert(key, std::move(value), hash);
+    LOG_DEBUG("ADD - Key: ", key, inserted ? " (new)" : " (updated)");
     return true;
 }
 
 // delete
-bool RedisHashMap::del(const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] DEL operation - Key: " << key 
-              << ", Current entries: " << count << std::endl;
-    
-    size_t idx = getIndex(key);
-    auto& bucket = buckets[idx];
-
-    auto it = std::find_if(bucket.begin(), bucket.end(),
-        [&](const HashEntry& e) { return e.key == key; });
-
-    if (it != bucket.end()) {
-        bucket.erase(it);
-        count--;     // decrement count
-        std::cout << "[" << getTimestamp() << "] [INFO] DEL - SUCCESS - Key deleted: " << key 
-                  << ", Bucket index: " << idx << ", Remaining entries: " << count << std::endl;
-        return true;
-    }
-
-    std::cout << "[" << getTimestamp() << "] [WARN] DEL - Key not found: " << key << std::endl;
-    return false; // not found
+bool RedisHashMap::del(std::string_view key) {
+    KeyHash hash = hashKey(key);
+    bool deleted = shard(hash).erase(key, hash);
+    LOG_DEBUG("DEL - Key: ", key, ", Deleted: ", (deleted ? "YES" : "NO"));
+    return deleted;
 }
 
 // exists
-bool RedisHashMap::exists(const std::string& key) const {
-    size_t idx = getIndex(key);
-    const auto& bucket = buckets[idx];
-
-    bool found = std::any_of(bucket.begin(), bucket.end(),
-        [&](const HashEntry& e) { return e.key == key; });
-    
-    std::cout << "[" << getTimestamp() << "] [INFO] EXISTS - Key: " << key 
-              << ", Exists: " << (found ? "YES" : "NO") << ", Bucket index: " << idx << std::endl;
-    
+bool RedisHashMap::exists(std::string_view key) const {
+    KeyHash hash = hashKey(key);
+    bool found = shards[shardFor(hash)]->find(key, hash) != nullptr;
+    LOG_DEBUG("EXISTS - Key: ", key, ", Exists: ", (found ? "YES" : "NO"));
     return found;
 }
 
 // rename
-bool RedisHashMap::rename(const std::string& oldKey, const std::string& newKey) {
-    std::cout << "[" << getTimestamp() << "] [INFO] RENAME operation - Old key: " << oldKey 
-              << ", New key: " << newKey << std::endl;
-    
-    size_t oldIdx = getIndex(oldKey);
-    size_t newIdx = getIndex(newKey);
-
-    auto& oldBucket = buckets[oldIdx];
-
-    auto it = std::find_if(oldBucket.begin(), oldBucket.end(),
-        [&](const HashEntry& e) { return e.key == oldKey; });
-
-    if (it == oldBucket.end()) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] RENAME - Old key not found: " << oldKey << std::endl;
+// the value is moved to the new key, an existing destination is overwritten like in redis
+bool RedisHashMap::rename(std::string_view oldKey, std::string_view newKey) {
+    LOG_DEBUG("RENAME operation - Old key: ", oldKey, ", New key: ", newKey);
+    if (oldKey == newKey) return exists(oldKey);
+
+    KeyHash hash = hashKey(oldKey);
+    std::optional<RedisObject> value = shard(hash).extract(oldKey, hash);
+    if (!value) {
+        LOG_DEBUG("RENAME - Old key not found: ", oldKey);
         return false; // oldkey not found
     }
 
-    RedisObject value = it->value;
-    oldBucket.erase(it);
-
     // insert newkey
-    buckets[newIdx].emplace_back(newKey, value);
-    std::cout << "[" << getTimestamp() << "] [INFO] RENAME - SUCCESS - Old key: " << oldKey 
-              << " → New key: " << newKey << ", Old bucket: " << oldIdx 
-              << ", New bucket: " << newIdx << std::endl;
+    emplace(newKey, std::move(*value));
     return true;
 }
 
 // copy
-bool RedisHashMap::copy(const std::string& sourceKey, const std::string& destKey) {
-    std::cout << "[" << getTimestamp() << "] [INFO] COPY operation - Source key: " << sourceKey 
-              << ", Dest key: " << destKey << std::endl;
-    
-    size_t srcIdx = getIndex(sourceKey);
-    auto& srcBucket = buckets[srcIdx];
-
-    auto it = std::find_if(srcBucket.begin(), srcBucket.end(),
-        [&](const HashEntry& e) { return e.key == sourceKey; });
-
-    if (it == srcBucket.end()) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] COPY - Source key not found: " << sourceKey << std::endl;
+bool RedisHashMap::copy(std::string_view sourceKey, std::string_view destKey) {
+    LOG_DEBUG("COPY operation - Source key: ", sourceKey, ", Dest key: ", destKey);
+
+    RedisObject* source = get(sourceKey);
+    if (!source) {
+        LOG_DEBUG("COPY - Source key not found: ", sourceKey);
         return false; // sourceKey not found
     }
 
-    RedisObject value = it->value;
-    add(destKey, value);
-    std::cout << "[" << getTimestamp() << "] [INFO] COPY - SUCCESS - Source: " << sourceKey 
-              << ", Destination: " << destKey << ", Total entries: " << count << std::endl;
+    // the copy shares the source's payload, whichever of the two is written first clones it
+    emplace(destKey, *source);
     return true;
 }
 
 // -------------------- Get --------------------
-RedisObject* RedisHashMap::get(const std::string& key) {
-    size_t idx = getIndex(key);
-    auto& bucket = buckets[idx];
+RedisObject* RedisHashMap::get(std::string_view key) {
+    KeyHash hash = hashKey(key);
+    HashEntry* entry = shard(hash).find(key, hash);
+    LOG_DEBUG("GET - Key: ", key, ", Found: ", (entry ? "YES" : "NO"));
+    return entry ? &entry->value : nullptr;
+}
 
-    auto it = std::find_if(bucket.begin(), bucket.end(),
-        [&](const HashEntry& e) { return e.key == key; });
+// -------------------- Batched access --------------------
+// every batch goes through three passes: hash and prefetch the buckets, prefetch the entries the
+// buckets point to, resolve. each pass only waits on the loads of the pass before it, which were
+// all issued together
+template <typename Fn>
+void RedisHashMap::forEachBatched(std::span<const std::string_view> keys, size_t stride, Fn&& fn) const {
+    KeyHash hashes[PREFETCH_BATCH];
+    KeyspaceShard* owners[PREFETCH_BATCH];
+    size_t total = (keys.size() + stride - 1) / stride;
+
+    for (size_t first = 0; first < total; first += PREFETCH_BATCH) {
+        size_t n = std::min(PREFETCH_BATCH, total - first);
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = hashKey(keys[(first + i) * stride]);
+            owners[i] = shards[shardFor(hashes[i])].get();
+            owners[i]->prefetchBucket(hashes[i]);
+        }
+        for (size_t i = 0; i < n; i++) owners[i]->prefetchEntries(hashes[i]);
+        for (size_t i = 0; i < n; i++) fn((first + i) * stride, hashes[i], *owners[i]);
+    }
+}
 
-    if (it != bucket.end()) {
-        std::cout << "[" << getTimestamp() << "] [INFO] GET - SUCCESS - Key: " << key 
-                  << ", Bucket index: " << idx << std::endl;
-        return &it->value;
+void RedisHashMap::getMany(std::span<const std::string_view> keys, RedisObject** values) {
+    forEachBatched(keys, 1, [&](size_t i, KeyHash hash, KeyspaceShard& s) {
+        HashEntry* entry = s.find(keys[i], hash);
+        values[i] = entry ? &entry->value : nullptr;
+    });
+    LOG_DEBUG("GET (batched) - Keys: ", keys.size());
+}
+
+size_t RedisHashMap::existsMany(std::span<const std::string_view> keys) const {
+    size_t found = 0;
+    forEachBatched(keys, 1, [&](size_t i, KeyHash hash, KeyspaceShard& s) {
+        found += s.find(keys[i], hash) != nullptr;
+    });
+    LOG_DEBUG("EXISTS (batched) - Keys: ", keys.size(), ", Found: ", found);
+    return found;
+}
+
+size_t RedisHashMap::delMany(std::span<const std::string_view> keys) {
+    size_t deleted = 0;
+    forEachBatched(keys, 1, [&](size_t i, KeyHash hash, KeyspaceShard& s) {
+        deleted += s.erase(keys[i], hash);
+    });
+    LOG_DEBUG("DEL (batched) - Keys: ", keys.size(), ", Deleted: ", deleted);
+    return deleted;
+}
+
+void RedisHashMap::addMany(std::span<const std::string_view> pairs) {
+    forEachBatched(pairs, 2, [&](size_t i, KeyHash hash, KeyspaceShard& s) {
+        s.insert(pairs[i], RedisObject::stringValue(pairs[i + 1]), hash);
+    });
+    LOG_DEBUG("ADD (batched) - Pairs: ", pairs.size() / 2);
+}
+
+void RedisHashMap::prefetch(std::span<const std::string_view> keys, bool lock) {
+    KeyHash hashes[PREFETCH_BATCH];
+    for (size_t first = 0; first < keys.size(); first += PREFETCH_BATCH) {
+        size_t n = std::min(PREFETCH_BATCH, keys.size() - first);
+        uint64_t mask = 0;
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = hashKey(keys[first + i]);
+            mask |= uint64_t(1) << shardFor(hashes[i]);
+        }
+        std::optional<ShardGuard> guard;
+        if (lock) guard.emplace(*this, mask, false);
+        for (size_t i = 0; i < n; i++) shard(hashes[i]).prefetchBucket(hashes[i]);
+        for (size_t i = 0; i < n; i++) shard(hashes[i]).prefetchEntries(hashes[i]);
     }
+}
 
-    std::cout << "[" << getTimestamp() << "] [WARN] GET - Key not found: " << key 
-              << ", Bucket index: " << idx << std::endl;
-    return nullptr; 
+bool RedisHashMap::isRehashing() const {
+    for (auto& s : shards)
+        if (s->isRehashing() || s->wantsShrink()) return true;
+    return false;
 }
 
+bool RedisHashMap::rehashFor(std::chrono::microseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    bool pending = false;
+    for (auto& s : shards) {
+        if (!s->isRehashing() && !s->wantsShrink()) continue;
+        // a shard in use by a command is left for the next tick instead of waiting on it
+        std::unique_lock<std::shared_mutex> lock(s->lock, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            pending = true;
+            continue;
+        }
+        if (s->wantsShrink()) s->shrinkIfSparse();
+        while (s->rehashStep(REHASH_IDLE_BATCH)) {
+            if (std::chrono::steady_clock::now() >= deadline) return true;
+        }
+    }
+    return pending;
+}
+
+uint64_t RedisHashMap::scan(uint64_t cursor, size_t count, std::vector<std::string>& keys) {
+    size_t s = (size_t)(cursor >> SCAN_SHARD_SHIFT);
+    uint64_t v = cursor & ((uint64_t(1) << SCAN_SHARD_SHIFT) - 1);
+    size_t visits = std::max<size_t>(count, 1) * 10;
+    std::vector<const HashEntry*> found;
+
+    while (s < shards.size() && keys.size() < count && visits > 0) {
+        KeyspaceShard& shard = *shards[s];
+        std::shared_lock<std::shared_mutex> lock(shard.lock);
+        // an empty shard is skipped whole, walking its buckets would only use up the budget
+        if (shard.size() > 0) {
+            do {
+                found.clear();
+                v = shard.scan(v, found);
+                for (const HashEntry* entry : found) keys.emplace_back(entry->key);
+            } while (v != 0 && keys.size() < count && --visits > 0);
+        } else {
+            v = 0;
+        }
+        if (v == 0) s++;
+    }
+    LOG_DEBUG("SCAN - Cursor: ", cursor, ", Keys: ", keys.size());
+    return s < shards.size() ? (uint64_t)s << SCAN_SHARD_SHIFT | v : 0;
+}
+
+void RedisHashMap::enableReadIndex() {
+    for (auto& s : shards) s->readIndex = std::make_unique<ReadIndex>(s->capacity());
+    readIndexed = true;
+    LOG_INFO("Read optimized mode enabled - lock-free GET/EXISTS/STRLEN/HGET");
+}
+
+const ReadSnapshot* RedisHashMap::snapshot(std::string_view key) const {
+    KeyHash hash = hashKey(key);
+    return shards[shardFor(hash)]->readIndex->find(key, hash);
+}
+
+void RedisHashMap::publish(std::string_view key) {
+    if (!readIndexed) return;
+    KeyHash hash = hashKey(key);
+    KeyspaceShard& s = shard(hash);
+    ReadIndex& index = *s.readIndex;
+
+    HashEntry* entry = s.find(key, hash);
+    if (!entry) return index.remove(key, hash);
+
+    // lists and sets are only visible to the lock-free path through their type, a write that
+    // keeps the type leaves their snapshot as it is. so does a write that left a hash's payload
+    // alone (an HDEL of a missing field), the snapshot still shares it
+    RedisType type = entry->value.getType();
+    const ReadSnapshot* current = index.find(key, hash);
+    if (current && current->type == type) {
+        if (type != RedisType::STRING && type != RedisType::HASH) return;
+        if (type == RedisType::HASH && current->value == entry->value) return;
+    }
+    // the snapshot shares the value's payload, nothing is copied
+    index.publish(new ReadSnapshot(key, hash, entry->value));
+}
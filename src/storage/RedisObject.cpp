@@ -1,138 +1,408 @@
 #include "storage/RedisObject.hpp"
 #include "storage/LinkedList.hpp"
+#include <algorithm>
+#include <charconv>
+#include <new>
+#include <tuple>
 
-// clear pointer header
-void RedisObject::clearPtr() {
-    if (!ptr) return;
+// constructors
+RedisObject::RedisObject(RedisType type) : type(type) {
     switch (type) {
-        case RedisType::INT:
-            delete static_cast<int*>(ptr);
-            break;
-        case RedisType::STRING:
-            delete static_cast<std::string*>(ptr);
-            break;
-        case RedisType::BOOL:
-            delete static_cast<bool*>(ptr);
-            break;
         case RedisType::LIST:
-            delete static_cast<LinkedList*>(ptr);
+            makePayload<LinkedList>();
             break;
         case RedisType::HASH:
-            delete static_cast<std::unordered_map<std::string, RedisObject>*>(ptr);
+            makePayload<PackedHash>();
+            encoding = Encoding::PACKED;
             break;
         case RedisType::SET:
-            delete static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(ptr);
+            store<SharedHeader*>(new (::operator new(sizeof(SharedInts))) SharedInts(2, 0));
+            encoding = Encoding::INTSET;
+            break;
+        default:
+            store<int64_t>(0);   // 0, false, or an empty inline string
             break;
     }
-    ptr = nullptr;
 }
 
-// -clone pointer for deep copy
-void* RedisObject::clonePtr() const {
-    if (!ptr) return nullptr;
-    switch (type) {
-        case RedisType::INT:
-            return new int(*static_cast<int*>(ptr));
-        case RedisType::STRING:
-            return new std::string(*static_cast<std::string*>(ptr));
-        case RedisType::BOOL:
-            return new bool(*static_cast<bool*>(ptr));
-        case RedisType::LIST: {
-            // We expect a LinkedList* (created elsewhere)
-            LinkedList* src = static_cast<LinkedList*>(ptr);
-            if (!src) return nullptr;
-            return src->clone(); // uses LinkedList::clone()
-        }
-        case RedisType::HASH:
-            return new std::unordered_map<std::string, RedisObject>(*static_cast<std::unordered_map<std::string, RedisObject>*>(ptr));
-        case RedisType::SET:
-            return new std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>(*static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(ptr));
+RedisObject::RedisObject(int value) : type(RedisType::INT) {
+    store<int64_t>(value);
+}
+
+RedisObject::RedisObject(const std::string& value) : type(RedisType::STRING) {
+    setString(value);
+}
+
+// a long string keeps its buffer, only the std::string moves into the payload
+RedisObject::RedisObject(std::string&& value) : type(RedisType::STRING) {
+    if (value.size() <= EMBED_CAP) setString(value);
+    else makePayload<std::string>(std::move(value));
+}
+
+RedisObject::RedisObject(std::string_view value) : type(RedisType::STRING) {
+    setString(value);
+}
+
+RedisObject::RedisObject(bool value) : type(RedisType::BOOL) {
+    store<int64_t>(value ? 1 : 0);
+}
+
+RedisObject::RedisObject(LinkedList&& list) : type(RedisType::LIST) {
+    makePayload<LinkedList>(std::move(list));
+}
+
+RedisObject::RedisObject(const HashFields& value) : type(RedisType::HASH) {
+    makePayload<HashFields>(value);
+}
+
+RedisObject::RedisObject(HashFields&& value) : type(RedisType::HASH) {
+    makePayload<HashFields>(std::move(value));
+}
+
+RedisObject::RedisObject(const SetMembers& value) : type(RedisType::SET) {
+    makePayload<SetMembers>(value);
+}
+
+RedisObject::RedisObject(SetMembers&& value) : type(RedisType::SET) {
+    makePayload<SetMembers>(std::move(value));
+}
+
+// only the canonical form is taken as a number, GET has to give back the exact bytes of SET
+static bool canonicalInt(std::string_view s, long long& out) {
+    if (s.empty() || s.size() > 20) return false;
+    size_t digits = s[0] == '-' ? 1 : 0;
+    if (digits == s.size() || (s[digits] == '0' && (s.size() > 1))) return false;   // "-", "-0", "05"
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+RedisObject RedisObject::stringValue(std::string_view value) {
+    long long n;
+    if (canonicalInt(value, n)) return stringValue(n);
+    return RedisObject(value);
+}
+
+RedisObject RedisObject::stringValue(long long value) {
+    RedisObject obj(std::string_view{});
+    obj.setInt(value);
+    return obj;
+}
+
+void RedisObject::setInt(long long value) {
+    release();
+    store<int64_t>(value);
+    encoding = Encoding::INT;
+}
+
+std::string RedisObject::toString() const {
+    if (encoding == Encoding::INT) return std::to_string(getInt());
+    return std::string(str());
+}
+
+size_t RedisObject::strSize() const {
+    if (encoding != Encoding::INT) return str().size();
+    char buf[24];
+    return (size_t)(std::to_chars(buf, buf + sizeof(buf), getInt()).ptr - buf);
+}
+
+// short strings are copied into the object, medium ones are embedded, longer ones get a
+// std::string of their own
+void RedisObject::setString(std::string_view s) {
+    if (s.size() <= INLINE_CAP) {
+        if (!s.empty()) std::memcpy(data, s.data(), s.size());
+        len = (uint8_t)s.size();
+        encoding = Encoding::INLINE;
+    } else if (s.size() <= EMBED_CAP) {
+        setEmbedded(s);
+    } else {
+        makePayload<std::string>(s);
     }
-    return nullptr;
 }
 
-// constructors
-RedisObject::RedisObject(int value) {
-    type = RedisType::INT;
-    ptr = new int(value);
+void RedisObject::setEmbedded(std::string_view s) {
+    auto* e = new (::operator new(sizeof(Embedded) + s.size())) Embedded();
+    e->size = (uint32_t)s.size();
+    std::memcpy(e->bytes(), s.data(), s.size());
+    store<SharedHeader*>(e);
+    encoding = Encoding::EMBEDDED;
 }
 
-RedisObject::RedisObject(const std::string& value) {
-    type = RedisType::STRING;
-    ptr = new std::string(value);
+void RedisObject::append(std::string_view s) {
+    if (encoding == Encoding::INT) {
+        char buf[24];
+        char* end = std::to_chars(buf, buf + sizeof(buf), getInt()).ptr;
+        setString(std::string_view(buf, (size_t)(end - buf)));   // at most 20 bytes, stays inline
+    }
+    if (encoding == Encoding::HEAP) {
+        ownPayload<std::string>().append(s);
+        return;
+    }
+    if (encoding == Encoding::INLINE && len + s.size() <= INLINE_CAP) {
+        std::memcpy(data + len, s.data(), s.size());
+        len += (uint8_t)s.size();
+        return;
+    }
+    // inline overflowing or embedded, both are rebuilt. the old bytes are read before release()
+    std::string_view old = str();
+    if (old.size() + s.size() <= EMBED_CAP) {
+        char buf[EMBED_CAP];
+        std::memcpy(buf, old.data(), old.size());
+        if (!s.empty()) std::memcpy(buf + old.size(), s.data(), s.size());
+        release();
+        setEmbedded(std::string_view(buf, old.size() + s.size()));
+        return;
+    }
+    std::string grown;
+    grown.reserve(old.size() + s.size());
+    grown.append(old).append(s);
+    release();
+    makePayload<std::string>(std::move(grown));
 }
 
-RedisObject::RedisObject(bool value) {
-    type = RedisType::BOOL;
-    ptr = new bool(value);
+// a payload nobody else holds is written in place. the acquire pairs with the release of the
+// other holders dropping their references, their last reads happen before our writes
+template <typename T>
+T& RedisObject::ownPayload() {
+    if (header()->refs.load(std::memory_order_acquire) != 1) {
+        auto* copy = new Shared<T>(payload<T>());
+        Encoding kept = encoding;
+        release();
+        store<SharedHeader*>(copy);
+        encoding = kept;
+    }
+    return payload<T>();
 }
 
-RedisObject::RedisObject(LinkedList* list) {
-    type = RedisType::LIST;
-    ptr = list; // ownership transferred in current design
+template LinkedList& RedisObject::ownPayload<LinkedList>();
+template HashFields& RedisObject::ownPayload<HashFields>();
+template SetMembers& RedisObject::ownPayload<SetMembers>();
+
+// ---------- Hashes ----------
+size_t RedisObject::hashSize() const {
+    return packedHash() ? packed()->size() : hash()->size();
 }
 
-RedisObject::RedisObject(const std::vector<RedisObject>& value) {
-    type = RedisType::LIST;
-    // If this ctor is used store a vector
-    ptr = new std::vector<RedisObject>(value);
+std::optional<std::string_view> RedisObject::hashGet(std::string_view field) const {
+    if (packedHash()) return packed()->get(field);
+    auto it = hash()->find(field);
+    if (it == hash()->end()) return std::nullopt;
+    return it->second.str();
 }
 
-RedisObject::RedisObject(const std::unordered_map<std::string, RedisObject>& value) {
-    type = RedisType::HASH;
-    ptr = new std::unordered_map<std::string, RedisObject>(value);
+// a packed hash takes the write as long as it stays within the limits, otherwise it is unpacked
+// first. a shared payload is only cloned once there is something to write
+bool RedisObject::hashSet(std::string_view field, std::string_view value) {
+    if (packedHash()) {
+        const PackedHash& p = *packed();
+        if (PackedHash::fits(field) && PackedHash::fits(value) &&
+            (p.size() < PackedHash::maxFields || p.contains(field)))
+            return ownPayload<PackedHash>().set(field, value);
+        unpackHash();
+    }
+    HashFields& fields = ownPayload<HashFields>();
+    auto it = fields.find(field);
+    if (it != fields.end()) {
+        it->second = RedisObject(value);
+        return false;
+    }
+    // the field name is only copied when it is new, the value is built in the node
+    fields.emplace(std::piecewise_construct, std::forward_as_tuple(field), std::forward_as_tuple(value));
+    return true;
 }
 
-RedisObject::RedisObject(const std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>& value) {
-    type = RedisType::SET;
-    ptr = new std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>(value);
+// a hash that shrinks below the limits again stays unpacked, like in redis
+bool RedisObject::hashDel(std::string_view field) {
+    if (packedHash()) return packed()->contains(field) && ownPayload<PackedHash>().erase(field);
+    if (hash()->find(field) == hash()->end()) return false;
+    HashFields& fields = ownPayload<HashFields>();
+    fields.erase(fields.find(field));
+    return true;
 }
 
-// copy constructor deep
-RedisObject::RedisObject(const RedisObject& other) {
+// ---------- Sets ----------
+size_t RedisObject::setSize() const {
+    return intSet() ? ints()->size() : set()->size();
+}
+
+bool RedisObject::setContains(const RedisObject& member) const {
+    if (!intSet()) return set()->count(member) > 0;
+    if (member.intEncoded()) return ints()->contains(member.getInt());
+    long long n;
+    return canonicalInt(member.str(), n) && ints()->contains(n);
+}
+
+bool RedisObject::setContains(std::string_view member) const {
+    if (!intSet()) return set()->count(RedisObject(member)) > 0;
+    long long n;
+    return canonicalInt(member, n) && ints()->contains(n);
+}
+
+IntSet* RedisObject::mutableInts() {
+    const IntSet& s = *ints();
+    if (header()->refs.load(std::memory_order_acquire) != 1) return &reshapeInts(s.memberWidth(), s.capacity());
+    return static_cast<SharedInts*>(header());
+}
+
+// the copy on write clone, the growth and the widening of an intset are all the same copy into
+// a new block
+IntSet& RedisObject::reshapeInts(uint8_t width, size_t capacity) {
+    void* block = ::operator new(sizeof(SharedInts) + IntSet::bytesFor(width, capacity));
+    auto* copy = new (block) SharedInts(width, (uint32_t)capacity);
+    copy->copyFrom(*ints());
+    release();
+    store<SharedHeader*>(copy);
+    encoding = Encoding::INTSET;
+    return *copy;
+}
+
+IntSet& RedisObject::intsFor(int64_t v) {
+    const IntSet& s = *ints();
+    bool shared = header()->refs.load(std::memory_order_acquire) != 1;
+    if (!shared && s.hasRoomFor(v)) return *static_cast<SharedInts*>(header());
+    // a full block doubles, up to the size the set can reach before it is unpacked
+    size_t capacity = s.capacity();
+    if (s.size() == capacity)
+        capacity = std::min(std::max<size_t>(4, capacity * 2), std::max(IntSet::maxEntries, s.size() + 1));
+    return reshapeInts(std::max(s.memberWidth(), IntSet::widthFor(v)), capacity);
+}
+
+// an intset takes the member as long as it is an integer and the set stays within the limit,
+// otherwise it is unpacked first. a shared payload is only cloned when the member is new
+bool RedisObject::setAdd(std::string_view member) {
+    if (intSet()) {
+        long long n;
+        const IntSet& s = *ints();
+        if (canonicalInt(member, n) && (s.size() < IntSet::maxEntries || s.contains(n)))
+            return !s.contains(n) && intsFor(n).insert(n);
+        unpackSet();
+    }
+    if (setContains(member)) return false;
+    return ownPayload<SetMembers>().emplace(member).second;
+}
+
+// a set that shrinks back to integers stays unpacked, like in redis
+bool RedisObject::setRemove(std::string_view member) {
+    if (!setContains(member)) return false;
+    if (intSet()) {
+        long long n;
+        canonicalInt(member, n);
+        return mutableInts()->erase(n);
+    }
+    return ownPayload<SetMembers>().erase(RedisObject(member)) > 0;
+}
+
+void RedisObject::unpackSet() {
+    SetMembers members;
+    members.reserve(ints()->size() + 1);
+    ints()->forEach([&](int64_t v) {
+        char buf[24];
+        char* end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+        members.emplace(std::string_view(buf, (size_t)(end - buf)));
+    });
+    release();
+    makePayload<SetMembers>(std::move(members));
+}
+
+void RedisObject::unpackHash() {
+    HashFields fields;
+    fields.reserve(packed()->size() + 1);
+    packed()->forEach([&](std::string_view f, std::string_view v) {
+        fields.emplace(std::piecewise_construct, std::forward_as_tuple(f), std::forward_as_tuple(v));
+    });
+    release();
+    makePayload<HashFields>(std::move(fields));
+}
+
+void RedisObject::release() {
+    if (!onHeap()) return;
+    SharedHeader* h = header();
+    Encoding was = encoding;
+    encoding = Encoding::INLINE;
+    len = 0;
+    if (h->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if (was == Encoding::EMBEDDED) {
+        auto* e = static_cast<Embedded*>(h);
+        e->~Embedded();
+        ::operator delete(e);
+        return;
+    }
+    if (was == Encoding::INTSET) {
+        auto* s = static_cast<SharedInts*>(h);
+        s->~SharedInts();
+        ::operator delete(s);
+        return;
+    }
+    switch (type) {
+        case RedisType::STRING:
+            delete static_cast<Shared<std::string>*>(h);
+            break;
+        case RedisType::LIST:
+            delete static_cast<Shared<LinkedList>*>(h);
+            break;
+        case RedisType::HASH:
+            if (was == Encoding::PACKED) delete static_cast<Shared<PackedHash>*>(h);
+            else delete static_cast<Shared<HashFields>*>(h);
+            break;
+        case RedisType::SET:
+            delete static_cast<Shared<SetMembers>*>(h);
+            break;
+        default:
+            break;
+    }
+}
+
+// the bytes are taken over as they are, the other object is left an empty inline value that
+// owns nothing
+void RedisObject::takeFrom(RedisObject& other) {
+    std::memcpy(data, other.data, INLINE_CAP);
+    len = other.len;
+    encoding = other.encoding;
+    type = other.type;
+    other.encoding = Encoding::INLINE;
+    other.len = 0;
+}
+
+// inline values are plain bytes, a heap part gets one more reference. relaxed is enough, the
+// caller already sees the payload through other
+void RedisObject::copyFrom(const RedisObject& other) {
+    std::memcpy(data, other.data, INLINE_CAP);
+    len = other.len;
+    encoding = other.encoding;
     type = other.type;
-    if (other.ptr)
-        ptr = other.clonePtr();
-    else
-        ptr = nullptr;
+    if (onHeap()) header()->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// copy constructor, shares the payload
+RedisObject::RedisObject(const RedisObject& other) {
+    copyFrom(other);
 }
 
-// copy asssignment deep
+// copy asssignment, shares the payload
 RedisObject& RedisObject::operator=(const RedisObject& other) {
     if (this == &other) return *this;
-    // free current
-    clearPtr();
-    type = other.type;
-    ptr = other.ptr ? other.clonePtr() : nullptr;
+    if (onHeap() && other.onHeap() && header() == other.header())
+        return *this;
+    release();
+    copyFrom(other);
     return *this;
 }
 
 // moving constructor
 RedisObject::RedisObject(RedisObject&& other) noexcept {
-    type = other.type;
-    ptr = other.ptr;
-    other.ptr = nullptr;
-    // Optionally set other.type to some default; we leave it as-is
+    takeFrom(other);
 }
 
 // moving assignment
 RedisObject& RedisObject::operator=(RedisObject&& other) noexcept {
     if (this == &other) return *this;
-    clearPtr();
-    type = other.type;
-    ptr = other.ptr;
-    other.ptr = nullptr;
+    release();
+    takeFrom(other);
     return *this;
 }
 
 // destructor
 RedisObject::~RedisObject() {
-    clearPtr();
-}
-
-// type returner
-RedisType RedisObject::getType() const {
-    return type;
+    release();
 }
 
 // eqwuality
@@ -140,32 +410,34 @@ bool RedisObject::operator==(const RedisObject& other) const {
     if (type != other.type) return false;
     switch (type) {
         case RedisType::INT:
-            return *(int*)ptr == *(int*)other.ptr;
-        case RedisType::STRING:
-            return *(std::string*)ptr == *(std::string*)other.ptr;
         case RedisType::BOOL:
-            return *(bool*)ptr == *(bool*)other.ptr;
-        case RedisType::LIST:
-        case RedisType::HASH:
-        case RedisType::SET:
-            return ptr == other.ptr; // for complex types we still compare pointer identity
+            return load<int64_t>() == other.load<int64_t>();
+        case RedisType::STRING:
+            if (intEncoded() && other.intEncoded()) return getInt() == other.getInt();
+            if (intEncoded() || other.intEncoded()) return toString() == other.toString();
+            return str() == other.str();
         default:
-            return ptr == other.ptr;
+            return header() == other.header(); // for complex types we still compare pointer identity
     }
 }
 
 // hashing for redis object
 std::size_t RedisObjectHash::operator()(const RedisObject& obj) const {
-    switch (obj.type) {
+    switch (obj.getType()) {
         case RedisType::INT:
-            return std::hash<int>()(*(int*)obj.ptr);
+            return std::hash<long long>()(obj.getInt());
         case RedisType::STRING:
-            return std::hash<std::string>()(*(std::string*)obj.ptr);
+            return (std::size_t)keyhash::hash(obj.intEncoded() ? obj.toString() : obj.str());
         case RedisType::BOOL:
-            return std::hash<bool>()(*(bool*)obj.ptr);
-        default:
-            return std::hash<void*>()(obj.ptr); // fallback for list/hash/set
+            return std::hash<bool>()(obj.getBool());
+        case RedisType::LIST:
+            return std::hash<const void*>()(obj.list());
+        case RedisType::HASH:
+            return std::hash<const void*>()(obj.packedHash() ? (const void*)obj.packed() : obj.hash());
+        case RedisType::SET:
+            return std::hash<const void*>()(obj.intSet() ? (const void*)obj.ints() : obj.set());
     }
+    return 0;
 }
 
 bool RedisObjectEqual::operator()(const RedisObject& a, const RedisObject& b) const {
@@ -1,153 +1,189 @@
 // this file basically handles all operations for redis like sets in our custom storage  
-// every set is stored inside our main redis hashmap as a redisobject that internally holds an unordered set  
+// every set is stored inside our main redis hashmap as a redisobject, sets of only integers are a
+// sorted intset and everything else an unordered set, redisobject picks and converts  
 // all these commands mimic the actual redis behaviour but simplified for our own db  
 
 #include "storage/RedisSets.hpp"
-#include <sstream>
+#include "storage/scan.hpp"
 #include <algorithm>
 #include <random>
 
 namespace setstore {
 
-    // this helper either fetches the set if it already exists or creates a new empty one
+    // this helper either fetches the set if it already exists or creates a new empty one in place
     // also if the key exists but is not a set we return nullptr so caller can send error
-    std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>* getOrCreateSet(RedisHashMap& map, const std::string& key) {
-        RedisObject* obj = map.get(key);
-        if (!obj) {
-            std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual> s;
-            map.add(key, RedisObject(s));
-            obj = map.get(key);
-        }
-
+    RedisObject* getOrCreateSet(RedisHashMap& map, std::string_view key) {
+        RedisObject* obj = map.tryEmplace(key, RedisType::SET).first;
         if (obj->getType() != RedisType::SET) return nullptr;
-        return static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
+        return obj;
     }
 
+    // the set stored under key, or nullptr when it is missing or not a set
+    static const RedisObject* findSet(RedisHashMap& map, std::string_view key) {
+        const RedisObject* obj = map.get(key);
+        return obj && obj->getType() == RedisType::SET ? obj : nullptr;
+    }
+
+    static void writeMember(ReplyWriter& out, const RedisObject& member) {
+        if (member.intEncoded()) out.bulk(member.getInt());
+        else out.bulk(member.str());
+    }
+
+    // the result of the set algebra commands. members of unordered sets are pointed to where they
+    // are, intset members only exist as numbers and are kept by value
+    struct Members {
+        std::vector<const RedisObject*> objects;
+        std::vector<long long> numbers;
+
+        void add(const RedisObject& member) {
+            if (member.intEncoded()) numbers.push_back(member.getInt());
+            else objects.push_back(&member);
+        }
+        void write(ReplyWriter& out) const {
+            out.arrayHeader(objects.size() + numbers.size());
+            for (const RedisObject* item : objects) out.bulk(item->str());
+            for (long long n : numbers) out.bulk(n);
+        }
+    };
+
     // sadd means insert a value into the set stored under key if key doesnt exist we create the set and then add the value
-    std::string sadd(RedisHashMap& map, const std::string& key, const std::string& value) {
+    void sadd(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out) {
         auto* s = getOrCreateSet(map, key);
-        if (!s) return "-ERR Key exists but is not a set";
-        size_t inserted = s->emplace(RedisObject(value)).second ? 1 : 0;
-        return std::to_string(inserted);
+        if (!s) return out.error("ERR Key exists but is not a set");
+        out.integer(s->setAdd(value) ? 1 : 0);
     }
 
     // srem removes a value from a set if set exists and has the value it removes it and returns 1 otherwise 0
-    std::string srem(RedisHashMap& map, const std::string& key, const std::string& value) {
+    void srem(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out) {
         RedisObject* obj = map.get(key);
-        if (!obj || obj->getType() != RedisType::SET) return "0";
-        auto* s = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
-        size_t erased = s->erase(RedisObject(value));
-        return std::to_string(erased);
+        if (!obj || obj->getType() != RedisType::SET) return out.integer(0);
+        out.integer(obj->setRemove(value) ? 1 : 0);
     }
 
-    // smembers just dumps all members of the set in a single space separated string if key doesnt exist or isnt a set returns an error
-    std::string smembers(RedisHashMap& map, const std::string& key) {
-        RedisObject* obj = map.get(key);
-        if (!obj || obj->getType() != RedisType::SET) return "-ERR no such set";
-        auto* s = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
-        std::stringstream ss;
-        for (const auto& item : *s) {
-            ss << item.getValue<std::string>() << " ";
-        }
-        std::string res = ss.str();
-        if (!res.empty()) res.pop_back(); // remove trailing space
-        return res;
+    // smembers replies with every member of the set as an array if key doesnt exist or isnt a set returns an error
+    void smembers(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+        const RedisObject* s = findSet(map, key);
+        if (!s) return out.error("ERR no such set");
+        out.arrayHeader(s->setSize());
+        s->forEachMember([&](const RedisObject& item) { writeMember(out, item); });
     }
 
     // scard returns the count of elements inside the set
-    std::string scard(RedisHashMap& map, const std::string& key) {
-        RedisObject* obj = map.get(key);
-        if (!obj || obj->getType() != RedisType::SET) return "0";
-        auto* s = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
-        return std::to_string(s->size());
+    void scard(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+        const RedisObject* s = findSet(map, key);
+        out.integer(s ? s->setSize() : 0);
     }
 
     // spop randomly picks and removes one element from the set
     // random delete like redis spop
-    std::string spop(RedisHashMap& map, const std::string& key) {
+    void spop(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
         RedisObject* obj = map.get(key);
-        if (!obj || obj->getType() != RedisType::SET) return "-ERR no such set";
-        auto* s = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
-        if (s->empty()) return "-ERR set empty";
+        if (!obj || obj->getType() != RedisType::SET) return out.error("ERR no such set");
+        if (obj->setSize() == 0) return out.error("ERR set empty");
+
+        // an intset is an array, any position is one index away
+        if (obj->intSet()) {
+            auto* s = obj->mutableInts();
+            int64_t v = s->at(rand() % s->size());
+            out.bulk((long long)v);
+            s->erase(v);
+            return;
+        }
 
+        auto* s = obj->mutableSet();
         auto it = s->begin();
         std::advance(it, rand() % s->size());
-        std::string val = it->getValue<std::string>();
+        out.bulk(it->str());
         s->erase(it);
-        return val;
     }
 
     // sismember checks if a value is present inside the set returns 1 or 0
-    std::string sismember(RedisHashMap& map, const std::string& key, const std::string& value) {
+    void sismember(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out) {
+        const RedisObject* s = findSet(map, key);
+        out.integer(s && s->setContains(value) ? 1 : 0);
+    }
+
+    // sscan walks the members a few buckets at a time instead of all at once like smembers
+    // a missing key is an empty set so the walk ends right away. an intset is small enough to be
+    // returned whole by the first call, like redis does
+    void sscan(RedisHashMap& map, std::string_view key, std::span<const std::string_view> args, ReplyWriter& out) {
+        scanner::Options opts;
+        if (!scanner::parseOptions(args, opts, out)) return;
+
         RedisObject* obj = map.get(key);
-        if (!obj || obj->getType() != RedisType::SET) return "0";
-        auto* s = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj->getPtr());
-        return s->count(RedisObject(value)) ? "1" : "0";
+        std::vector<std::string> members;
+        if (!obj) return scanner::reply(out, 0, members, opts.pattern);
+        if (obj->getType() != RedisType::SET) return out.error("ERR Key exists but is not a set");
+
+        uint64_t next = 0;
+        if (obj->intSet()) {
+            members.reserve(obj->setSize());
+            obj->forEachMember([&](const RedisObject& item) { members.push_back(item.toString()); });
+        } else {
+            next = scanner::walkBuckets(*obj->set(), opts.cursor, opts.count, [&](const RedisObject& item) {
+                members.emplace_back(item.str());
+            });
+        }
+        scanner::reply(out, next, members, opts.pattern);
     }
 
     // sunion combines members of two sets removes duplicates because set
     // returns all unique values from set1 and set2
-    std::string sunion(RedisHashMap& map, const std::string& key1, const std::string& key2) {
-        RedisObject* obj1 = map.get(key1);
-        RedisObject* obj2 = map.get(key2);
-        std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual> result;
-
-        if (obj1 && obj1->getType() == RedisType::SET) {
-            auto* s1 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj1->getPtr());
-            result.insert(s1->begin(), s1->end());
+    void sunion(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out) {
+        const RedisObject* s1 = findSet(map, key1);
+        const RedisObject* s2 = findSet(map, key2);
+        Members result;
+
+        // two intsets are merged in order, no lookups at all
+        if (s1 && s2 && s1->intSet() && s2->intSet()) {
+            IntSet::unite(*s1->ints(), *s2->ints(), [&](int64_t v) { result.numbers.push_back(v); });
+            return result.write(out);
         }
 
-        if (obj2 && obj2->getType() == RedisType::SET) {
-            auto* s2 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj2->getPtr());
-            result.insert(s2->begin(), s2->end());
+        if (s1) s1->forEachMember([&](const RedisObject& item) { result.add(item); });
+        // members of set2 are only added when set1 does not already have them
+        if (s2) {
+            s2->forEachMember([&](const RedisObject& item) {
+                if (!s1 || !s1->setContains(item)) result.add(item);
+            });
         }
-
-        std::stringstream ss;
-        for (const auto& item : result) ss << item.getValue<std::string>() << " ";
-        std::string res = ss.str();
-        if (!res.empty()) res.pop_back();
-        return res;
+        result.write(out);
     }
 
     // sinter finds common elements between two sets
     // if either key doesnt have a valid set returns empty result
-    std::string sinter(RedisHashMap& map, const std::string& key1, const std::string& key2) {
-        RedisObject* obj1 = map.get(key1);
-        RedisObject* obj2 = map.get(key2);
-        if (!obj1 || obj1->getType() != RedisType::SET) return "";
-        if (!obj2 || obj2->getType() != RedisType::SET) return "";
-
-        auto* s1 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj1->getPtr());
-        auto* s2 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj2->getPtr());
-
-        std::stringstream ss;
-        for (const auto& item : *s1) {
-            if (s2->count(item)) ss << item.getValue<std::string>() << " ";
+    void sinter(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out) {
+        const RedisObject* s1 = findSet(map, key1);
+        const RedisObject* s2 = findSet(map, key2);
+        if (!s1 || !s2) return out.arrayHeader(0);
+
+        Members result;
+        if (s1->intSet() && s2->intSet()) {
+            IntSet::intersect(*s1->ints(), *s2->ints(), [&](int64_t v) { result.numbers.push_back(v); });
+            return result.write(out);
         }
-        std::string res = ss.str();
-        if (!res.empty()) res.pop_back();
-        return res;
+        s1->forEachMember([&](const RedisObject& item) {
+            if (s2->setContains(item)) result.add(item);
+        });
+        result.write(out);
     }
 
     // sdiff does set difference meaning everything in set1 minus anything found in set2
     // basically elements unique to first set
-    std::string sdiff(RedisHashMap& map, const std::string& key1, const std::string& key2) {
-        RedisObject* obj1 = map.get(key1);
-        RedisObject* obj2 = map.get(key2);
-        if (!obj1 || obj1->getType() != RedisType::SET) return "";
-        auto* s1 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj1->getPtr());
-        std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual> result = *s1;
-
-        if (obj2 && obj2->getType() == RedisType::SET) {
-            auto* s2 = static_cast<std::unordered_set<RedisObject, RedisObjectHash, RedisObjectEqual>*>(obj2->getPtr());
-            for (const auto& item : *s2) result.erase(item);
+    void sdiff(RedisHashMap& map, std::string_view key1, std::string_view key2, ReplyWriter& out) {
+        const RedisObject* s1 = findSet(map, key1);
+        const RedisObject* s2 = findSet(map, key2);
+        if (!s1) return out.arrayHeader(0);
+
+        Members result;
+        if (s2 && s1->intSet() && s2->intSet()) {
+            IntSet::difference(*s1->ints(), *s2->ints(), [&](int64_t v) { result.numbers.push_back(v); });
+            return result.write(out);
         }
-
-        std::stringstream ss;
-        for (const auto& item : result) ss << item.getValue<std::string>() << " ";
-        std::string res = ss.str();
-        if (!res.empty()) res.pop_back();
-        return res;
+        s1->forEachMember([&](const RedisObject& item) {
+            if (!s2 || !s2->setContains(item)) result.add(item);
+        });
+        result.write(out);
     }
 
 }
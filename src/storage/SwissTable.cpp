@@ -0,0 +1,208 @@
+#include "storage/SwissTable.hpp"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_SSE2 1
+#endif
+
+static size_t roundToGroups(size_t capacity) {
+    size_t n = SwissTable::GROUP;
+    while (n < capacity) n <<= 1;
+    return n;
+}
+
+SwissTable::SwissTable(size_t capacity) {
+    if (capacity == 0) return;   // placeholder, RedisHashMap only probes tables it has sized
+    slotCount = roundToGroups(capacity);
+    groupMask = slotCount / GROUP - 1;
+    ctrl = new int8_t[slotCount];
+    std::fill(ctrl, ctrl + slotCount, EMPTY);
+    slots = std::allocator<HashEntry>().allocate(slotCount);
+}
+
+SwissTable::~SwissTable() {
+    release();
+}
+
+SwissTable::SwissTable(SwissTable&& other) noexcept
+    : ctrl(other.ctrl), slots(other.slots), slotCount(other.slotCount),
+      groupMask(other.groupMask), count(other.count), tombstones(other.tombstones) {
+    other.ctrl = nullptr;
+    other.slots = nullptr;
+    other.slotCount = other.groupMask = other.count = other.tombstones = 0;
+}
+
+SwissTable& SwissTable::operator=(SwissTable&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    ctrl = other.ctrl;
+    slots = other.slots;
+    slotCount = other.slotCount;
+    groupMask = other.groupMask;
+    count = other.count;
+    tombstones = other.tombstones;
+    other.ctrl = nullptr;
+    other.slots = nullptr;
+    other.slotCount = other.groupMask = other.count = other.tombstones = 0;
+    return *this;
+}
+
+// destroy the live entries and free both arrays
+void SwissTable::release() {
+    if (!ctrl) return;
+    for (size_t i = 0; i < slotCount; i++) {
+        if (ctrl[i] >= 0) std::destroy_at(&slots[i]);
+    }
+    std::allocator<HashEntry>().deallocate(slots, slotCount);
+    delete[] ctrl;
+    ctrl = nullptr;
+    slots = nullptr;
+}
+
+#ifdef SWISS_SSE2
+uint32_t SwissTable::matchTag(const int8_t* group, int8_t t) {
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(t)));
+}
+
+uint32_t SwissTable::matchEmpty(const int8_t* group) {
+    return matchTag(group, EMPTY);
+}
+
+// EMPTY and DELETED are the only control bytes with the top bit set
+uint32_t SwissTable::matchFree(const int8_t* group) {
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return (uint32_t)_mm_movemask_epi8(g);
+}
+#else
+// portable fallback, same results one byte at a time
+uint32_t SwissTable::matchTag(const int8_t* group, int8_t t) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP; i++) mask |= (uint32_t)(group[i] == t) << i;
+    return mask;
+}
+
+uint32_t SwissTable::matchEmpty(const int8_t* group) {
+    return matchTag(group, EMPTY);
+}
+
+uint32_t SwissTable::matchFree(const int8_t* group) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP; i++) mask |= (uint32_t)(group[i] < 0) << i;
+    return mask;
+}
+#endif
+
+static inline unsigned lowestBit(uint32_t mask) {
+    return (unsigned)std::countr_zero(mask);
+}
+
+// groups are probed triangularly (home, +1, +3, +6 ...), which visits every group once
+// because the group count is a power of two. a group with an EMPTY slot ends the probe
+size_t SwissTable::findSlot(std::string_view key, KeyHash hash) const {
+    int8_t t = tag(hash);
+    size_t g = homeGroup(hash) & groupMask;
+    for (size_t step = 1; step <= groupMask + 1; step++) {
+        const int8_t* group = ctrl + g * GROUP;
+        for (uint32_t m = matchTag(group, t); m; m &= m - 1) {
+            size_t slot = g * GROUP + lowestBit(m);
+            if (slots[slot].matches(key, hash)) return slot;
+        }
+        if (matchEmpty(group)) break;
+        g = (g + step) & groupMask;
+    }
+    return slotCount;
+}
+
+size_t SwissTable::freeSlot(KeyHash hash) const {
+    size_t g = homeGroup(hash) & groupMask;
+    for (size_t step = 1; ; step++) {
+        uint32_t m = matchFree(ctrl + g * GROUP);
+        if (m) return g * GROUP + lowestBit(m);
+        g = (g + step) & groupMask;
+    }
+}
+
+void SwissTable::prefetchBucket(KeyHash hash) const {
+    if (slotCount) prefetchRead(ctrl + (homeGroup(hash) & groupMask) * GROUP);
+}
+
+// only the home group, a key that was pushed further along is rare below the load limit
+void SwissTable::prefetchEntries(KeyHash hash) const {
+    if (!slotCount) return;
+    size_t g = homeGroup(hash) & groupMask;
+    for (uint32_t m = matchTag(ctrl + g * GROUP, tag(hash)); m; m &= m - 1)
+        prefetchRead(&slots[g * GROUP + lowestBit(m)]);
+}
+
+HashEntry* SwissTable::find(std::string_view key, KeyHash hash) {
+    size_t slot = findSlot(key, hash);
+    return slot == slotCount ? nullptr : &slots[slot];
+}
+
+HashEntry* SwissTable::insert(std::string_view key, RedisObject&& value, KeyHash hash) {
+    size_t slot = freeSlot(hash);
+    if (ctrl[slot] == DELETED) tombstones--;
+    ctrl[slot] = tag(hash);
+    count++;
+    return ::new (&slots[slot]) HashEntry(key, hash, std::move(value));
+}
+
+bool SwissTable::erase(std::string_view key, KeyHash hash) {
+    size_t slot = findSlot(key, hash);
+    if (slot == slotCount) return false;
+
+    std::destroy_at(&slots[slot]);
+    count--;
+    // if the group still has an EMPTY slot no probe ever went past it, so this slot can be
+    // EMPTY again. otherwise a later key may sit further down the probe sequence
+    if (matchEmpty(ctrl + (slot / GROUP) * GROUP)) {
+        ctrl[slot] = EMPTY;
+    } else {
+        ctrl[slot] = DELETED;
+        tombstones++;
+    }
+    return true;
+}
+
+// entries are moved, not copied, and placed by their stored hash. the emptied slots become DELETED rather than EMPTY because
+// keys of groups not migrated yet may still probe through this one
+size_t SwissTable::migrate(size_t unit, SwissTable& dest) {
+    size_t moved = 0;
+    size_t base = unit * GROUP;
+    for (size_t i = base; i < base + GROUP; i++) {
+        if (ctrl[i] < 0) continue;
+        HashEntry& entry = slots[i];
+        size_t slot = dest.freeSlot(entry.hash);
+        if (dest.ctrl[slot] == DELETED) dest.tombstones--;
+        dest.ctrl[slot] = tag(entry.hash);
+        ::new (&dest.slots[slot]) HashEntry(std::move(entry));
+        dest.count++;
+
+        std::destroy_at(&entry);
+        ctrl[i] = DELETED;
+        tombstones++;
+        count--;
+        moved++;
+    }
+    return moved;
+}
+
+// the keys whose home is this group, wherever their probe put them. like a lookup the walk
+// ends at the first group with an EMPTY slot
+void SwissTable::scanUnit(size_t unit, std::vector<const HashEntry*>& out) const {
+    size_t g = unit;
+    for (size_t step = 1; step <= groupMask + 1; step++) {
+        const int8_t* group = ctrl + g * GROUP;
+        for (uint32_t m = ~matchFree(group) & 0xFFFF; m; m &= m - 1) {
+            const HashEntry& entry = slots[g * GROUP + lowestBit(m)];
+            if ((homeGroup(entry.hash) & groupMask) == unit) out.push_back(&entry);
+        }
+        if (matchEmpty(group)) break;
+        g = (g + step) & groupMask;
+    }
+}
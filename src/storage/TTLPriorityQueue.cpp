@@ -1,25 +1,19 @@
 #include "storage/TTLPriorityQueue.hpp"
-#include <iostream>
+#include "logging/logger.hpp"
 #include <cassert>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 // this file implements the ttl priority queue used to track expiring keys.
 // each entry is stored with its expiration timestamp and ordered by soonest-to-expire.
 // the database uses this queue to efficiently process expired items.
 // it ensures that ttl checks are fast even at large scale.
 
-// logging utility with simple timestamp
-static std::string getTimestamp() {
-    auto now_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    char buf[64];
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&now_t));
-    return std::string(buf);
-}
-
 // ttl priority q implementation
 
-TTLPriorityQueue::TTLPriorityQueue(RedisHashMap* db)
-    : dbPtr(db), running(false) {
+TTLPriorityQueue::TTLPriorityQueue(RedisHashMap* db, bool threaded)
+    : dbPtr(db), threaded(threaded), running(false) {
     // worker started automatically if start(db) enabled
 }
 
@@ -35,13 +29,13 @@ void TTLPriorityQueue::start(RedisHashMap* db) {
         return;
     }
     if (!db && !dbPtr) {
-        std::cerr << "[" << getTimestamp() << "] [ERROR] TTLPriorityQueue::start requires a valid RedisHashMap* db\n";
+        LOG_ERROR("TTLPriorityQueue::start requires a valid RedisHashMap* db");
         return;
     }
     if (db) dbPtr = db;
     running.store(true);
     worker = std::thread(&TTLPriorityQueue::workerLoop, this);
-    std::cout << "[" << getTimestamp() << "] [INFO] TTLPriorityQueue started\n";
+    LOG_INFO("TTLPriorityQueue started");
 }
 
 void TTLPriorityQueue::stop() {
@@ -56,19 +50,19 @@ void TTLPriorityQueue::stop() {
     }
     if (hadThread && worker.joinable()) {
         worker.join();
-        std::cout << "[" << getTimestamp() << "] [INFO] TTLPriorityQueue stopped\n";
+        LOG_INFO("TTLPriorityQueue stopped");
     }
 }
 
 size_t TTLPriorityQueue::size() const {
-    std::lock_guard<std::mutex> lock(mu);
+    auto lock = lockHeap();
     return heap.size();
 }
 
-bool TTLPriorityQueue::insertOrUpdate(const std::string& key, long long seconds) {
+bool TTLPriorityQueue::insertOrUpdate(std::string_view key, long long seconds) {
     // db existence check will return false if db key doesnt exist
     if (!dbPtr) {
-        std::cerr << "[" << getTimestamp() << "] [ERROR] TTLPriorityQueue: dbPtr is null in insertOrUpdate\n";
+        LOG_ERROR("TTLPriorityQueue: dbPtr is null in insertOrUpdate");
         return false;
     }
     if (!dbPtr->exists(key)) {
@@ -77,7 +71,7 @@ bool TTLPriorityQueue::insertOrUpdate(const std::string& key, long long seconds)
 
     auto expiry = now() + std::chrono::seconds(seconds);
 
-    std::lock_guard<std::mutex> lock(mu);
+    auto lock = lockHeap();
     auto it = indexMap.find(key);
     if (it != indexMap.end()) {
         // expiry reheapify update
@@ -90,18 +84,18 @@ bool TTLPriorityQueue::insertOrUpdate(const std::string& key, long long seconds)
     }
 
     // new insert
+    size_t idx = heap.size();
     ttlObject obj;
-    obj.key = key;
+    obj.key = std::string(key);
     obj.expireAt = expiry;
+    indexMap.emplace(obj.key, idx);
     heap.push_back(std::move(obj));
-    size_t idx = heap.size() - 1;
-    indexMap[key] = idx;
     heapifyUp(idx);
     return true;
 }
 
-bool TTLPriorityQueue::remove(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mu);
+bool TTLPriorityQueue::remove(std::string_view key) {
+    auto lock = lockHeap();
     auto it = indexMap.find(key);
     if (it == indexMap.end()) return false;
 
@@ -111,8 +105,8 @@ bool TTLPriorityQueue::remove(const std::string& key) {
     if (idx != last) {
         swapNodes(idx, last);
     }
-    // remove last
-    indexMap.erase(key);
+    // remove last, swapNodes only reassigns so it is still valid
+    indexMap.erase(it);
     heap.pop_back();
 
     if (idx < heap.size()) {
@@ -123,13 +117,13 @@ bool TTLPriorityQueue::remove(const std::string& key) {
     return true;
 }
 
-long long TTLPriorityQueue::getTTLSeconds(const std::string& key) const {
+long long TTLPriorityQueue::getTTLSeconds(std::string_view key) const {
     if (!dbPtr) return -2; // if no db then treat as absent
 
     // first check DB presence
     if (!dbPtr->exists(key)) return -2;
 
-    std::lock_guard<std::mutex> lock(mu);
+    auto lock = lockHeap();
     auto it = indexMap.find(key);
     if (it == indexMap.end()) return -1; // no ttl but exists
 
@@ -205,9 +199,12 @@ void TTLPriorityQueue::processExpiredLocked() {
             // unlock before calling db->del to prevent re entrancy issues
             mu.unlock();
             // log and delete from DB
-            std::cout << "[" << getTimestamp() << "] [INFO] TTL EXPIRE - Key expired: " << keyToExpire << std::endl;
+            LOG_DEBUG("TTL EXPIRE - Key expired: ", keyToExpire);
             if (dbPtr) {
+                // clients run on other threads, take the key's shard like any write command
+                RedisHashMap::ShardGuard guard(*dbPtr, dbPtr->shardMask(keyToExpire), true);
                 dbPtr->del(keyToExpire);
+                dbPtr->publish(keyToExpire);
             }
             mu.lock();
             // recompute now to avoid long loops based on stale time
@@ -218,6 +215,24 @@ void TTLPriorityQueue::processExpiredLocked() {
     }
 }
 
+int TTLPriorityQueue::expireDue(size_t budget) {
+    // the caller is the only thread using the keyspace, nothing to lock
+    auto nowtp = now();
+    while (!heap.empty() && heap[0].expireAt <= nowtp) {
+        if (budget-- == 0) return 0;
+        std::string keyToExpire = popRootNoLock();
+        LOG_DEBUG("TTL EXPIRE - Key expired: ", keyToExpire);
+        if (dbPtr) {
+            dbPtr->del(keyToExpire);
+            dbPtr->publish(keyToExpire);
+        }
+    }
+    if (heap.empty()) return -1;
+    // rounded up, waking a little early would only find nothing due yet
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(heap[0].expireAt - nowtp).count();
+    return (int)std::min<long long>(wait, INT32_MAX);
+}
+
 void TTLPriorityQueue::workerLoop() {
     while (running.load()) {
         // wait for either the interval or stop signal
@@ -238,18 +253,29 @@ void TTLPriorityQueue::workerLoop() {
 
 // global singleton accessor 
 // single global pointer 
-static TTLPriorityQueue* g_ttl = nullptr;
+// one queue per keyspace, the shared-nothing server runs a private keyspace on every core
+static std::unordered_map<RedisHashMap*, TTLPriorityQueue*> g_ttl;
+
+static std::mutex g_ttlInit;
+
+TTLPriorityQueue* getGlobalTTL(RedisHashMap* db, bool worker) {
+    // queues are never freed, so a thread that keeps asking for the same keyspace (every core of
+    // the shared-nothing server) remembers its queue instead of taking the registry lock
+    thread_local RedisHashMap* lastDb = nullptr;
+    thread_local TTLPriorityQueue* lastQueue = nullptr;
+    if (lastQueue && lastDb == db) return lastQueue;
 
-TTLPriorityQueue* getGlobalTTL(RedisHashMap* db) {
+    // several client threads may reach this at once
+    std::lock_guard<std::mutex> lock(g_ttlInit);
+    TTLPriorityQueue*& q = g_ttl[db];
     // lazy init
-    if (!g_ttl) {
+    if (!q) {
         // create and start
-        g_ttl = new TTLPriorityQueue(db);
-        if (db) g_ttl->start(db);
-    } else {
-        // ensure started if db provided and not started
-        if (db) g_ttl->start(db);
+        q = new TTLPriorityQueue(db, worker);
+        if (db && worker) q->start(db);
     }
-    return g_ttl;
+    lastDb = db;
+    lastQueue = q;
+    return q;
 }
 
@@ -0,0 +1,107 @@
+#include "storage/hash/keyhash.hpp"
+#include "storage/murmurhash/murmurhash3.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace keyhash {
+
+// default secret of wyhash, odd constants with balanced bits
+static const uint64_t SECRET[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+// full 64x64 multiply, low half to a and high half to b
+static inline void mum(uint64_t& a, uint64_t& b) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    a = _umul128(a, b, &b);
+#else
+    __uint128_t r = (__uint128_t)a * b;
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+#endif
+}
+
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+    mum(a, b);
+    return a ^ b;
+}
+
+// unaligned little endian loads, memcpy compiles down to a single mov
+static inline uint64_t read8(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+static inline uint64_t read4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+// 1 to 3 bytes, first, middle and last byte
+static inline uint64_t read3(const uint8_t* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t wyhash(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        // short keys: two overlapping reads cover the whole key, no loop
+        if (len >= 4) {
+            size_t shift = (len >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + shift);
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - shift);
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            // three independent lanes so the multiplies overlap
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // the last 16 bytes of the key, may overlap what the loop already consumed
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= SECRET[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
+
+uint64_t murmur3(const void* data, size_t len, uint64_t seed) {
+    return MurmurHash3_x86_32(data, (int)len, (uint32_t)seed);
+}
+
+uint64_t pickSeed() {
+    if (const char* fixed = std::getenv("HASH_SEED")) return std::strtoull(fixed, nullptr, 0);
+    std::random_device rd;
+    return ((uint64_t)rd() << 32) ^ rd();
+}
+
+} // namespace keyhash
@@ -1,192 +1,198 @@
 // handles all hash type operations for our redis clone  
 // so any time we want to store multiple fields under a single key we use this system  
-// everything here is basically managing an unordered map inside a redisobject and acting like redis hash commands  
-// this is where behaviour for hset hget hdel hgetall hexists hlen is defined and hooked into our main redis hashmap  
+// everything here is basically managing the fields inside a redisobject and acting like redis hash commands  
+// small hashes are packed into one buffer and bigger ones are an unordered map, redisobject picks and converts  
+// this is where behaviour for hset hget hdel hgetall hexists hlen hscan is defined and hooked into our main redis hashmap  
 
 #include "storage/hashmapstore.hpp"
 #include "storage/RedisObject.hpp"
-#include <sstream>
-#include <iostream>
-#include <chrono>
+#include "storage/scan.hpp"
+#include "logging/logger.hpp"
 
 namespace hashmapstore {
-// timestamp utility function this gives us a readable string for logs so we can trace when operations happened
-std::string getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buffer[20];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&time));
-    return buffer;
-}
 
 // hset adds or updates a field in a hash if the key doesnt exist we create a whole new hash for it  
-std::string hset(RedisHashMap& map, const std::string& key,
-                 const std::string& field, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HSET operation started - Key: " << key 
-              << ", Field: " << field << std::endl;
-
-    RedisObject* obj = map.get(key);
-    std::unordered_map<std::string, RedisObject>* hash;
+void hset(RedisHashMap& map, std::string_view key,
+          std::string_view field, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("HSET operation started - Key: ", key, ", Field: ", field);
 
-    if (!obj) {
-        hash = new std::unordered_map<std::string, RedisObject>();
-        hash->insert_or_assign(field, RedisObject(value));
-        map.add(key, RedisObject(*hash));
-        std::cout << "[" << getTimestamp() << "] [INFO] HSET - New hash created for key: " 
-                  << key << ", Field added: " << field << std::endl;
-        return ":1";
-    }
+    // a missing key gets an empty hash built right in its entry, one lookup either way
+    auto [obj, created] = map.tryEmplace(key, RedisType::HASH);
 
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HSET - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HSET - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
-    bool isNew = hash->find(field) == hash->end();
-    hash->insert_or_assign(field, RedisObject(value));
+    bool isNew = obj->hashSet(field, value);
     
-    std::cout << "[" << getTimestamp() << "] [INFO] HSET - Key: " << key << ", Field: " << field 
-              << " (" << (isNew ? "NEW" : "UPDATED") << "), Hash size: " << hash->size() << std::endl;
+    LOG_DEBUG("HSET - Key: ", key, ", Field: ", field, " (", (isNew ? "NEW" : "UPDATED"),
+              "), Hash size: ", obj->hashSize(), (obj->packedHash() ? " (packed)" : ""),
+              (created ? ", New hash created" : ""));
 
-    return isNew ? ":1" : ":0";
+    return out.integer(isNew ? 1 : 0);
 }
 
 // hget simply returns the value inside a hash for a specific field if key doesnt exist we return nil style like redis  
-std::string hget(RedisHashMap& map, const std::string& key,
-                 const std::string& field) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HGET operation - Key: " << key 
-              << ", Field: " << field << std::endl;
+void hget(RedisHashMap& map, std::string_view key,
+          std::string_view field, ReplyWriter& out) {
+    LOG_DEBUG("HGET operation - Key: ", key, ", Field: ", field);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HGET - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("HGET - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HGET - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HGET - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    auto* hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
-    auto it = hash->find(field);
-    if (it == hash->end()) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HGET - Field not found: " << field 
-                  << " in key: " << key << std::endl;
-        return "$-1";
+    auto value = obj->hashGet(field);
+    if (!value) {
+        LOG_DEBUG("HGET - Field not found: ", field, " in key: ", key);
+        return out.nil();
     }
 
-    std::cout << "[" << getTimestamp() << "] [INFO] HGET - SUCCESS - Key: " << key 
-              << ", Field: " << field << std::endl;
-    return it->second.getValue<std::string>();
+    LOG_DEBUG("HGET - SUCCESS - Key: ", key, ", Field: ", field);
+    out.bulk(*value);
 }
 
 // hdel deletes one or more fields from a hash  
 // returns number of fields removed similar to redis if key or field missing we just skip but count deleted
-std::string hdel(RedisHashMap& map, const std::string& key,
-                 const std::vector<std::string>& fields) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HDEL operation - Key: " << key 
-              << ", Fields count: " << fields.size() << std::endl;
+void hdel(RedisHashMap& map, std::string_view key,
+          std::span<const std::string_view> fields, ReplyWriter& out) {
+    LOG_DEBUG("HDEL operation - Key: ", key, ", Fields count: ", fields.size());
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HDEL - Key not found: " << key << std::endl;
-        return ":0";
+        LOG_DEBUG("HDEL - Key not found: ", key);
+        return out.integer(0);
     }
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HDEL - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HDEL - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    auto* hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
     int deleted = 0;
+    for (const auto& field : fields) deleted += obj->hashDel(field);
 
-    for (const auto& field : fields) {
-        if (hash->erase(field) > 0) deleted++;
-    }
+    LOG_DEBUG("HDEL - Key: ", key, ", Deleted: ", deleted, "/", fields.size(),
+              ", Remaining fields: ", obj->hashSize());
 
-    std::cout << "[" << getTimestamp() << "] [INFO] HDEL - Key: " << key << ", Deleted: " 
-              << deleted << "/" << fields.size() << ", Remaining fields: " << hash->size() << std::endl;
-
-    return ":" + std::to_string(deleted);
+    return out.integer(deleted);
 }
 
-// hgetall prints all fields and values in a hash returns a formatted structure similar to json but not exactly redis format  
-std::string hgetall(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HGETALL operation - Key: " << key << std::endl;
+// hgetall replies with all fields and values in a hash as a flat field value field value array like redis  
+void hgetall(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("HGETALL operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HGETALL - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("HGETALL - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HGETALL - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HGETALL - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    auto* hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
-    std::ostringstream out;
-    out << "{";
-
-    bool first = true;
-    for (auto& [field, val] : *hash) {
-        if (!first) out << ", ";
-        out << field << ": " << val.getValue<std::string>();
-        first = false;
-    }
-    out << "}";
+    out.arrayHeader(obj->hashSize() * 2);
+    obj->forEachField([&](std::string_view field, std::string_view value) {
+        out.bulk(field);
+        out.bulk(value);
+    });
     
-    std::cout << "[" << getTimestamp() << "] [INFO] HGETALL - SUCCESS - Key: " << key 
-              << ", Fields retrieved: " << hash->size() << std::endl;
-    return out.str();
+    LOG_DEBUG("HGETALL - SUCCESS - Key: ", key, ", Fields retrieved: ", obj->hashSize());
 }
 
 // hexists checks if a field exists inside the hash 
-std::string hexists(RedisHashMap& map, const std::string& key,
-                    const std::string& field) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HEXISTS operation - Key: " << key 
-              << ", Field: " << field << std::endl;
+void hexists(RedisHashMap& map, std::string_view key,
+             std::string_view field, ReplyWriter& out) {
+    LOG_DEBUG("HEXISTS operation - Key: ", key, ", Field: ", field);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HEXISTS - Key not found: " << key << std::endl;
-        return ":0";
+        LOG_DEBUG("HEXISTS - Key not found: ", key);
+        return out.integer(0);
     }
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HEXISTS - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HEXISTS - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    auto* hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
-    bool exists = hash->count(field) > 0;
+    bool exists = obj->hashGet(field).has_value();
     
-    std::cout << "[" << getTimestamp() << "] [INFO] HEXISTS - Key: " << key << ", Field: " 
-              << field << ", Exists: " << (exists ? "YES" : "NO") << std::endl;
-    return exists ? ":1" : ":0";
+    LOG_DEBUG("HEXISTS - Key: ", key, ", Field: ", field, ", Exists: ", (exists ? "YES" : "NO"));
+    return out.integer(exists ? 1 : 0);
 }
 
 // hlen returns number of fields in the hash  
-// basically size of the unordered map  
-std::string hlen(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] HLEN operation - Key: " << key << std::endl;
+void hlen(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("HLEN operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] HLEN - Key not found: " << key << std::endl;
-        return ":0";
+        LOG_DEBUG("HLEN - Key not found: ", key);
+        return out.integer(0);
     }
     if (obj->getType() != RedisType::HASH) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] HLEN - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("HLEN - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    auto* hash = static_cast<std::unordered_map<std::string, RedisObject>*>(obj->getPtr());
-    size_t size = hash->size();
+    size_t size = obj->hashSize();
     
-    std::cout << "[" << getTimestamp() << "] [INFO] HLEN - Key: " << key 
-              << ", Hash size: " << size << std::endl;
-    return ":" + std::to_string(size);
+    LOG_DEBUG("HLEN - Key: ", key, ", Hash size: ", size);
+    return out.integer(size);
+}
+
+// lock-free hget for read optimized mode, looks the field up in the key's snapshot
+void hgetSnapshot(const RedisHashMap& map, std::string_view key,
+                  std::string_view field, ReplyWriter& out) {
+    const ReadSnapshot* snap = map.snapshot(key);
+    LOG_DEBUG("HGET (lock-free) - Key: ", key, ", Field: ", field);
+    if (!snap) return out.nil();
+    if (snap->type != RedisType::HASH) return out.error("ERR wrong type");
+
+    auto value = snap->value.hashGet(field);
+    if (!value) return out.nil();
+    out.bulk(*value);
 }
 
-} 
+
+// hscan walks the fields a few buckets at a time, MATCH is applied to the field names
+// a missing key is an empty hash, the walk is over right away. a packed hash is small enough to
+// be returned whole by the first call, like redis does for its listpacks
+void hscan(RedisHashMap& map, std::string_view key,
+           std::span<const std::string_view> args, ReplyWriter& out) {
+    LOG_DEBUG("HSCAN operation - Key: ", key);
+
+    scanner::Options opts;
+    if (!scanner::parseOptions(args, opts, out)) return;
+
+    RedisObject* obj = map.get(key);
+    std::vector<std::string> items;
+    if (!obj) return scanner::reply(out, 0, items, opts.pattern, 2);
+    if (obj->getType() != RedisType::HASH) {
+        LOG_DEBUG("HSCAN - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
+    }
+
+    uint64_t next = 0;
+    if (obj->packedHash()) {
+        obj->forEachField([&](std::string_view field, std::string_view value) {
+            items.emplace_back(field);
+            items.emplace_back(value);
+        });
+    } else {
+        next = scanner::walkBuckets(*obj->hash(), opts.cursor, opts.count, [&](const auto& kv) {
+            items.push_back(kv.first);
+            items.emplace_back(kv.second.str());
+        });
+    }
+    LOG_DEBUG("HSCAN - Key: ", key, ", Cursor: ", opts.cursor, " -> ", next, ", Fields visited: ", items.size() / 2);
+    scanner::reply(out, next, items, opts.pattern, 2);
+}
+
+}
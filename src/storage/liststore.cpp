@@ -1,310 +1,265 @@
 #include "storage/liststore.hpp"
 #include "storage/RedisObject.hpp"
 #include "storage/LinkedList.hpp"
+#include "logging/logger.hpp"
 #include <vector>
 #include <string>
-#include <sstream>
-#include <iostream>
-#include <chrono>
+#include <charconv>
 
 namespace liststore {
 
-// timestamp utility
-std::string getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buffer[20];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&time));
-    return buffer;
+// parses a whole string view as a signed integer
+static bool parseIndex(std::string_view s, long long& out) {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
 }
 
 // Lpush
-std::string lpush(RedisHashMap& map, const std::string& key, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LPUSH operation - Key: " << key 
-              << ", Value: " << value << std::endl;
+void lpush(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("LPUSH operation - Key: ", key, ", Value length: ", value.size());
     
-    RedisObject* obj = map.get(key);
-    LinkedList* list;
-
-    if (!obj) {
-        list = new LinkedList();
-        list->push_front(value);          
-        map.add(key, RedisObject(list));
-        std::cout << "[" << getTimestamp() << "] [INFO] LPUSH - New list created for key: " 
-                  << key << ", List size: 1" << std::endl;
-        return ":1";
-    }
+    // a missing key gets an empty list built right in its entry
+    auto [obj, created] = map.tryEmplace(key, RedisType::LIST);
 
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LPUSH - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LPUSH - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
     list->push_front(value);
-    std::cout << "[" << getTimestamp() << "] [INFO] LPUSH - Key: " << key 
-              << ", Value pushed to front, List size: " << list->size << std::endl;
+    LOG_DEBUG("LPUSH - Key: ", key, (created ? ", New list created" : ""), ", Value pushed to front, List size: ", list->size);
 
-    return ":" + std::to_string(list->size);
+    return out.integer(list->size);
 }
 
-
 // Rpush
-std::string rpush(RedisHashMap& map, const std::string& key, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] RPUSH operation - Key: " << key 
-              << ", Value: " << value << std::endl;
+void rpush(RedisHashMap& map, std::string_view key, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("RPUSH operation - Key: ", key, ", Value length: ", value.size());
     
-    RedisObject* obj = map.get(key);
-    LinkedList* list;
-
-    if (!obj) {
-        list = new LinkedList();
-        list->push_back(value);            
-        map.add(key, RedisObject(list));
-        std::cout << "[" << getTimestamp() << "] [INFO] RPUSH - New list created for key: " 
-                  << key << ", List size: 1" << std::endl;
-        return ":1";
-    }
+    // a missing key gets an empty list built right in its entry
+    auto [obj, created] = map.tryEmplace(key, RedisType::LIST);
 
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] RPUSH - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("RPUSH - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
     list->push_back(value);
-    std::cout << "[" << getTimestamp() << "] [INFO] RPUSH - Key: " << key 
-              << ", Value pushed to back, List size: " << list->size << std::endl;
+    LOG_DEBUG("RPUSH - Key: ", key, (created ? ", New list created" : ""), ", Value pushed to back, List size: ", list->size);
 
-    return ":" + std::to_string(list->size);
+    return out.integer(list->size);
 }
 
 
 // Lpop
-std::string lpop(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LPOP operation - Key: " << key << std::endl;
+void lpop(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("LPOP operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LPOP - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("LPOP - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LPOP - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LPOP - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
     if (list->empty()) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LPOP - List is empty for key: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("LPOP - List is empty for key: ", key);
+        return out.nil();
     }
 
     std::string val = list->pop_front();
-    std::cout << "[" << getTimestamp() << "] [INFO] LPOP - SUCCESS - Key: " << key 
-              << ", Popped value: " << val << ", Remaining size: " << list->size << std::endl;
-    return val;
+    LOG_DEBUG("LPOP - SUCCESS - Key: ", key, ", Popped length: ", val.size(), ", Remaining size: ",
+              list->size);
+    out.bulk(val);
 }
 
 // Rpop
-std::string rpop(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] RPOP operation - Key: " << key << std::endl;
+void rpop(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("RPOP operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] RPOP - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("RPOP - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] RPOP - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("RPOP - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
     if (list->empty()) {
-        std::cout << "[" << getTimestamp() << "] [WARN] RPOP - List is empty for key: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("RPOP - List is empty for key: ", key);
+        return out.nil();
     }
 
     std::string val = list->pop_back();
-    std::cout << "[" << getTimestamp() << "] [INFO] RPOP - SUCCESS - Key: " << key 
-              << ", Popped value: " << val << ", Remaining size: " << list->size << std::endl;
-    return val;
+    LOG_DEBUG("RPOP - SUCCESS - Key: ", key, ", Popped length: ", val.size(), ", Remaining size: ",
+              list->size);
+    out.bulk(val);
 }
 
 // Llen
-std::string llen(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LLEN operation - Key: " << key << std::endl;
+void llen(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("LLEN operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LLEN - Key not found: " << key << std::endl;
-        return ":0";
+        LOG_DEBUG("LLEN - Key not found: ", key);
+        return out.integer(0);
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LLEN - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LLEN - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
-    std::cout << "[" << getTimestamp() << "] [INFO] LLEN - Key: " << key 
-              << ", List size: " << list->size << std::endl;
-    return ":" + std::to_string(list->size);
+    const LinkedList* list = obj->list();
+    LOG_DEBUG("LLEN - Key: ", key, ", List size: ", list->size);
+    return out.integer(list->size);
 }
 
 // Lindex
-std::string lindex(RedisHashMap& map, const std::string& key, const std::string& indexStr) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LINDEX operation - Key: " << key 
-              << ", Index: " << indexStr << std::endl;
+void lindex(RedisHashMap& map, std::string_view key, std::string_view indexStr, ReplyWriter& out) {
+    LOG_DEBUG("LINDEX operation - Key: ", key, ", Index: ", indexStr);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LINDEX - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("LINDEX - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LINDEX - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LINDEX - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    const LinkedList* list = obj->list();
     long long idx;
-    try { idx = std::stoll(indexStr); } 
-    catch (...) { 
-        std::cout << "[" << getTimestamp() << "] [ERROR] LINDEX - Invalid index: " << indexStr << std::endl;
-        return "-ERR invalid index"; 
+    if (!parseIndex(indexStr, idx)) { 
+        LOG_DEBUG("LINDEX - Invalid index: ", indexStr);
+        return out.error("ERR invalid index"); 
     }
 
     try {
         std::string val = list->get(idx);
-        std::cout << "[" << getTimestamp() << "] [INFO] LINDEX - SUCCESS - Key: " << key 
-                  << ", Index: " << idx << ", Value: " << val << std::endl;
-        return val;
+        LOG_DEBUG("LINDEX - SUCCESS - Key: ", key, ", Index: ", idx, ", Value length: ", val.size());
+        out.bulk(val);
     } catch (...) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LINDEX - Index out of range - Key: " << key 
-                  << ", Index: " << idx << std::endl;
-        return "$-1";
+        LOG_DEBUG("LINDEX - Index out of range - Key: ", key, ", Index: ", idx);
+        return out.nil();
     }
 }
 
 // Lset
-std::string lset(RedisHashMap& map, const std::string& key, const std::string& indexStr, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LSET operation - Key: " << key 
-              << ", Index: " << indexStr << ", Value: " << value << std::endl;
+void lset(RedisHashMap& map, std::string_view key, std::string_view indexStr, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("LSET operation - Key: ", key, ", Index: ", indexStr, ", Value length: ", value.size());
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSET - Key not found: " << key << std::endl;
-        return "-ERR no such key";
+        LOG_DEBUG("LSET - Key not found: ", key);
+        return out.error("ERR no such key");
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSET - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LSET - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
     if (!list) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSET - Internal error: list pointer null for key: " << key << std::endl;
-        return "-ERR internal error: list pointer null";
+        LOG_DEBUG("LSET - Internal error: list pointer null for key: ", key);
+        return out.error("ERR internal error: list pointer null");
     }
 
     long long idx;
-    try { idx = std::stoll(indexStr); } 
-    catch (...) { 
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSET - Invalid index: " << indexStr << std::endl;
-        return "-ERR invalid index"; 
+    if (!parseIndex(indexStr, idx)) { 
+        LOG_DEBUG("LSET - Invalid index: ", indexStr);
+        return out.error("ERR invalid index"); 
     }
 
     long long sz = static_cast<long long>(list->size);
     if (idx < 0) idx += sz;
 
     if (idx < 0 || idx >= sz) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSET - Index out of range - Key: " << key 
-                  << ", Index: " << idx << ", List size: " << sz << std::endl;
-        return "-ERR index out of range";
+        LOG_DEBUG("LSET - Index out of range - Key: ", key, ", Index: ", idx, ", List size: ", sz);
+        return out.error("ERR index out of range");
     }
 
     list->set(idx, value);
-    std::cout << "[" << getTimestamp() << "] [INFO] LSET - SUCCESS - Key: " << key 
-              << ", Index: " << idx << ", New value: " << value << std::endl;
-    return "+OK";
+    LOG_DEBUG("LSET - SUCCESS - Key: ", key, ", Index: ", idx, ", New value length: ", value.size());
+    return out.ok();
 }
 
-std::string lsort(RedisHashMap& map, const std::string& key, const std::string& orderStr) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LSORT operation - Key: " << key 
-              << ", Order: " << orderStr << std::endl;
+void lsort(RedisHashMap& map, std::string_view key, std::string_view orderStr, ReplyWriter& out) {
+    LOG_DEBUG("LSORT operation - Key: ", key, ", Order: ", orderStr);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSORT - Key not found: " << key << std::endl;
-        return "-ERR no such key";
+        LOG_DEBUG("LSORT - Key not found: ", key);
+        return out.error("ERR no such key");
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSORT - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LSORT - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    int order;
-    try {
-        order = std::stoi(orderStr);
-    } catch (...) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSORT - Invalid order value: " << orderStr << std::endl;
-        return "-ERR invalid order";
+    long long order;
+    if (!parseIndex(orderStr, order)) {
+        LOG_DEBUG("LSORT - Invalid order value: ", orderStr);
+        return out.error("ERR invalid order");
     }
 
     if (order != 1 && order != 2) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSORT - Order must be 1 or 2, got: " << order << std::endl;
-        return "-ERR order must be 1 (asc) or 2 (desc)";
+        LOG_DEBUG("LSORT - Order must be 1 or 2, got: ", order);
+        return out.error("ERR order must be 1 (asc) or 2 (desc)");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    LinkedList* list = obj->mutableList();
 
     try {
         list->sort(order == 1);
-        std::cout << "[" << getTimestamp() << "] [INFO] LSORT - SUCCESS - Key: " << key 
-                  << ", Order: " << (order == 1 ? "ASCENDING" : "DESCENDING") 
-                  << ", List size: " << list->size << std::endl;
+        LOG_DEBUG("LSORT - SUCCESS - Key: ", key, ", Order: ",
+                  (order == 1 ? "ASCENDING" : "DESCENDING"), ", List size: ", list->size);
     } catch (...) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LSORT - List contains non-numeric values for key: " << key << std::endl;
-        return "-ERR list contains non-numeric values";
+        LOG_DEBUG("LSORT - List contains non-numeric values for key: ", key);
+        return out.error("ERR list contains non-numeric values");
     }
 
-    return "+OK";
+    return out.ok();
 }
 
 // Lprint
-std::string lprint(RedisHashMap& map, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] LPRINT operation - Key: " << key << std::endl;
+void lprint(RedisHashMap& map, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("LPRINT operation - Key: ", key);
     
     RedisObject* obj = map.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] LPRINT - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("LPRINT - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::LIST) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] LPRINT - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("LPRINT - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    LinkedList* list = static_cast<LinkedList*>(obj->getPtr());
+    const LinkedList* list = obj->list();
     if (!list || list->empty()) {
-        std::cout << "[" << getTimestamp() << "] [INFO] LPRINT - Empty list for key: " << key << std::endl;
-        return "[]";
+        LOG_DEBUG("LPRINT - Empty list for key: ", key);
+        return out.arrayHeader(0);
     }
 
-    std::ostringstream out;
-    out << "[";
-
+    // every element as its own bulk string, head to tail
+    out.arrayHeader(list->size);
     ListNode* curr = list->head;
     while (curr) {
-        out << curr->value;
-        if (curr->next) out << ", ";
+        out.bulk(curr->value);
         curr = curr->next;
     }
 
-    out << "]";
-    std::cout << "[" << getTimestamp() << "] [INFO] LPRINT - SUCCESS - Key: " << key 
-              << ", Elements: " << list->size << std::endl;
-    return out.str();
+    LOG_DEBUG("LPRINT - SUCCESS - Key: ", key, ", Elements: ", list->size);
 }
 } 
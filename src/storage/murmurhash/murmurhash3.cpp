@@ -13,11 +13,11 @@ uint32_t MurmurHash3_x86_32(const void * key, int len, uint32_t seed)
     const uint32_t c1 = 0xcc9e2d51;
     const uint32_t c2 = 0x1b873593;
 
-    // body
-    const uint32_t* blocks = (const uint32_t*)(data + nblocks * 4);
-    for (int i = -nblocks; i; i++)
+    // body, blocks are loaded with memcpy since keys have no alignment guarantee
+    for (int i = 0; i < nblocks; i++)
     {
-        uint32_t k1 = blocks[i];
+        uint32_t k1;
+        std::memcpy(&k1, data + i * 4, 4);
 
         k1 *= c1;
         k1 = (k1 << 15) | (k1 >> (32 - 15));
@@ -55,7 +55,7 @@ uint32_t MurmurHash3_x86_32(const void * key, int len, uint32_t seed)
 }
 
 // Overload for string
-uint32_t MurmurHash3_x86_32(const std::string& str, uint32_t seed)
+uint32_t MurmurHash3_x86_32(std::string_view str, uint32_t seed)
 {
     return MurmurHash3_x86_32(str.data(), (int)str.size(), seed);
 }
@@ -0,0 +1,131 @@
+#include "storage/scan.hpp"
+#include <charconv>
+#include <cctype>
+#include <utility>
+
+namespace scanner {
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (std::toupper((unsigned char)a[i]) != std::toupper((unsigned char)b[i])) return false;
+        return true;
+    }
+
+    bool parseOptions(std::span<const std::string_view> args, Options& opts, ReplyWriter& out) {
+        if (args.empty()) {
+            out.error("ERR invalid cursor");
+            return false;
+        }
+        std::string_view c = args[0];
+        auto [end, ec] = std::from_chars(c.data(), c.data() + c.size(), opts.cursor);
+        if (ec != std::errc() || end != c.data() + c.size()) {
+            out.error("ERR invalid cursor");
+            return false;
+        }
+
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (i + 1 >= args.size()) {
+                out.error("ERR syntax error");
+                return false;
+            }
+            std::string_view value = args[i + 1];
+            if (equalsIgnoreCase(args[i], "MATCH")) {
+                // "*" matches everything, skip the per key matching for it
+                opts.pattern = value == "*" ? std::string_view() : value;
+            } else if (equalsIgnoreCase(args[i], "COUNT")) {
+                long long n = 0;
+                auto [e, err] = std::from_chars(value.data(), value.data() + value.size(), n);
+                if (err != std::errc() || e != value.data() + value.size()) {
+                    out.error("ERR value is not an integer or out of range");
+                    return false;
+                }
+                if (n < 1) {
+                    out.error("ERR syntax error");
+                    return false;
+                }
+                opts.count = (size_t)n;
+            } else {
+                out.error("ERR syntax error");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // matches one pattern element (a plain or escaped character, ? or a [...] class) at p[i]
+    // against c and moves i past the element
+    static bool matchOne(std::string_view p, size_t& i, char c) {
+        char head = p[i++];
+        if (head == '?') return true;
+        if (head == '\\' && i < p.size()) return p[i++] == c;
+        if (head != '[') return head == c;
+
+        bool negate = i < p.size() && p[i] == '^';
+        if (negate) i++;
+        bool hit = false;
+        while (i < p.size() && p[i] != ']') {
+            if (p[i] == '\\' && i + 1 < p.size()) {
+                hit |= p[i + 1] == c;
+                i += 2;
+            } else if (i + 2 < p.size() && p[i + 1] == '-' && p[i + 2] != ']') {
+                unsigned char lo = (unsigned char)p[i], hi = (unsigned char)p[i + 2];
+                if (lo > hi) std::swap(lo, hi);
+                hit |= (unsigned char)c >= lo && (unsigned char)c <= hi;
+                i += 3;
+            } else {
+                hit |= p[i] == c;
+                i++;
+            }
+        }
+        if (i < p.size()) i++;   // the closing ]
+        return negate ? !hit : hit;
+    }
+
+    // a * remembers where it was, a later mismatch retries with the * taking one more character
+    bool globMatch(std::string_view pattern, std::string_view s) {
+        size_t pi = 0, si = 0;
+        size_t starP = std::string_view::npos, starS = 0;
+        while (si < s.size()) {
+            if (pi < pattern.size() && pattern[pi] == '*') {
+                while (pi < pattern.size() && pattern[pi] == '*') pi++;
+                if (pi == pattern.size()) return true;
+                starP = pi;
+                starS = si;
+                continue;
+            }
+            size_t next = pi;
+            if (pi < pattern.size() && matchOne(pattern, next, s[si])) {
+                pi = next;
+                si++;
+                continue;
+            }
+            if (starP == std::string_view::npos) return false;
+            pi = starP;
+            si = ++starS;
+        }
+        while (pi < pattern.size() && pattern[pi] == '*') pi++;
+        return pi == pattern.size();
+    }
+
+    void reply(ReplyWriter& out, uint64_t cursor, const std::vector<std::string>& items,
+               std::string_view pattern, size_t stride) {
+        out.arrayHeader(2);
+        out.bulk(std::to_string(cursor));
+        if (pattern.empty()) {
+            out.arrayHeader(items.size());
+            for (const auto& item : items) out.bulk(item);
+            return;
+        }
+
+        std::vector<char> keep(items.size() / stride);
+        size_t kept = 0;
+        for (size_t g = 0; g < keep.size(); g++) kept += keep[g] = globMatch(pattern, items[g * stride]);
+        out.arrayHeader(kept * stride);
+        for (size_t g = 0; g < keep.size(); g++) {
+            if (!keep[g]) continue;
+            for (size_t k = 0; k < stride; k++) out.bulk(items[g * stride + k]);
+        }
+    }
+
+}
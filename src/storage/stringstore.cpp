@@ -1,309 +1,385 @@
 #include "storage/stringstore.hpp"
-#include <iostream>
+#include "storage/scan.hpp"
+#include "logging/logger.hpp"
 #include <vector>
-#include <sstream>
 #include <stdexcept>
-#include <chrono>
+#include <charconv>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
 
 namespace stringstore {
 
-// Utility function for timestamp
-std::string getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buffer[20];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&time));
-    return buffer;
-}
-
 // -------------------- SET --------------------
-std::string set(RedisHashMap& db, const std::string& key, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] SET operation - Key: " << key 
-              << ", Value length: " << value.size() << std::endl;
+void set(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("SET operation - Key: ", key, ", Value length: ", value.size());
     
-    RedisObject obj(value);
-    db.add(key, obj);
+    db.emplace(key, RedisObject::stringValue(value));
     
-    std::cout << "[" << getTimestamp() << "] [INFO] SET - SUCCESS - Key: " << key 
-              << ", Value: " << value << std::endl;
-    return "+OK";
+    LOG_DEBUG("SET - SUCCESS - Key: ", key, ", Value length: ", value.size());
+    return out.ok();
 }
 
 // -------------------- SETNX --------------------
-std::string setnx(RedisHashMap& db, const std::string& key, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] SETNX operation - Key: " << key 
-              << ", Value length: " << value.size() << std::endl;
+void setnx(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("SETNX operation - Key: ", key, ", Value length: ", value.size());
     
-    if (db.exists(key)) {
-        std::cout << "[" << getTimestamp() << "] [WARN] SETNX - Key already exists: " << key << std::endl;
-        return ":0";
+    // the value is only built when the key turns out to be new
+    bool created = db.getOrCreate(key, [&] { return RedisObject::stringValue(value); }).second;
+    if (!created) {
+        LOG_DEBUG("SETNX - Key already exists: ", key);
+        return out.integer(0);
     }
     
-    RedisObject obj(value);
-    db.add(key, obj);
-    
-    std::cout << "[" << getTimestamp() << "] [INFO] SETNX - SUCCESS - Key: " << key 
-              << ", Value: " << value << std::endl;
-    return ":1";
+    LOG_DEBUG("SETNX - SUCCESS - Key: ", key, ", Value length: ", value.size());
+    return out.integer(1);
 }
 
 // -------------------- MSET --------------------
-std::string mset(RedisHashMap& db, const std::vector<std::string>& kvs) {
-    std::cout << "[" << getTimestamp() << "] [INFO] MSET operation - Pairs count: " 
-              << (kvs.size() / 2) << std::endl;
+void mset(RedisHashMap& db, std::span<const std::string_view> kvs, ReplyWriter& out) {
+    LOG_DEBUG("MSET operation - Pairs count: ", (kvs.size() / 2));
     
     if (kvs.size() % 2 != 0) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] MSET - Wrong number of arguments: " 
-                  << kvs.size() << std::endl;
-        return "-ERR wrong number of arguments for MSET";
+        LOG_DEBUG("MSET - Wrong number of arguments: ", kvs.size());
+        return out.error("ERR wrong number of arguments for MSET");
     }
 
-    for (size_t i = 0; i < kvs.size(); i += 2) {
-        RedisObject obj(kvs[i + 1]);
-        db.add(kvs[i], obj);
-        std::cout << "[" << getTimestamp() << "] [DEBUG] MSET - Setting key: " << kvs[i] 
-                  << ", Value length: " << kvs[i + 1].size() << std::endl;
-    }
+    db.addMany(kvs);
     
-    std::cout << "[" << getTimestamp() << "] [INFO] MSET - SUCCESS - Total pairs set: " 
-              << (kvs.size() / 2) << std::endl;
-    return "+OK";
+    LOG_DEBUG("MSET - SUCCESS - Total pairs set: ", (kvs.size() / 2));
+    return out.ok();
 }
 
 // -------------------- MGET --------------------
-std::string mget(RedisHashMap& db, const std::vector<std::string>& keys) {
-    std::cout << "[" << getTimestamp() << "] [INFO] MGET operation - Keys count: " 
-              << keys.size() << std::endl;
+void mget(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out) {
+    LOG_DEBUG("MGET operation - Keys count: ", keys.size());
     
-    std::ostringstream out;
-    bool first = true;
     int foundCount = 0, notFoundCount = 0, wrongTypeCount = 0;
 
-    for (const auto& key : keys) {
-        if (!first) out << " ";
-        first = false;
-
-        RedisObject* obj = db.get(key);
-        if (!obj) {
-            out << "$-1";
-            notFoundCount++;
-            continue;
-        }
-        if (obj->getType() != RedisType::STRING) {
-            out << "-ERR wrong type";
-            wrongTypeCount++;
-            continue;
+    // one entry per key, missing keys and non string values come back as nil like redis
+    // the lookups go through getMany a chunk at a time so their cache misses overlap
+    RedisObject* values[RedisHashMap::PREFETCH_BATCH];
+    out.arrayHeader(keys.size());
+    for (size_t first = 0; first < keys.size(); first += RedisHashMap::PREFETCH_BATCH) {
+        auto chunk = keys.subspan(first, std::min(RedisHashMap::PREFETCH_BATCH, keys.size() - first));
+        db.getMany(chunk, values);
+        for (size_t i = 0; i < chunk.size(); i++) {
+            RedisObject* obj = values[i];
+            if (!obj) {
+                out.nil();
+                notFoundCount++;
+                continue;
+            }
+            if (obj->getType() != RedisType::STRING) {
+                out.nil();
+                wrongTypeCount++;
+                continue;
+            }
+            if (obj->intEncoded()) out.bulk(obj->getInt());
+            else out.bulk(obj->str());
+            foundCount++;
         }
-        out << obj->getValue<std::string>();
-        foundCount++;
     }
     
-    std::cout << "[" << getTimestamp() << "] [INFO] MGET - SUCCESS - Found: " << foundCount 
-              << ", Not found: " << notFoundCount << ", Wrong type: " << wrongTypeCount << std::endl;
-    return out.str();
+    LOG_DEBUG("MGET - SUCCESS - Found: ", foundCount, ", Not found: ", notFoundCount,
+              ", Wrong type: ", wrongTypeCount);
 }
 
 // -------------------- GET --------------------
-std::string get(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] GET operation - Key: " << key << std::endl;
+void get(RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("GET operation - Key: ", key);
     
     RedisObject* obj = db.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] GET - Key not found: " << key << std::endl;
-        return "$-1";
+        LOG_DEBUG("GET - Key not found: ", key);
+        return out.nil();
     }
     if (obj->getType() != RedisType::STRING) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] GET - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("GET - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
     
-    std::string value = obj->getValue<std::string>();
-    std::cout << "[" << getTimestamp() << "] [INFO] GET - SUCCESS - Key: " << key 
-              << ", Value: " << value << std::endl;
-    return value;
+    // integers are formatted straight into the reply
+    if (obj->intEncoded()) {
+        LOG_DEBUG("GET - SUCCESS - Key: ", key, ", Integer value: ", obj->getInt());
+        return out.bulk(obj->getInt());
+    }
+    std::string_view value = obj->str();
+    LOG_DEBUG("GET - SUCCESS - Key: ", key, ", Value length: ", value.size());
+    out.bulk(value);
 }
 
 // -------------------- DEL --------------------
-std::string del(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] DEL operation - Key: " << key << std::endl;
-    
-    bool deleted = db.del(key);
-    std::cout << "[" << getTimestamp() << "] [INFO] DEL - " << (deleted ? "SUCCESS" : "KEY_NOT_FOUND") 
-              << " - Key: " << key << std::endl;
-    return deleted ? ":1" : ":0";
+void del(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out) {
+    LOG_DEBUG("DEL operation - Keys count: ", keys.size());
+
+    size_t deleted = keys.size() == 1 ? db.del(keys[0]) : db.delMany(keys);
+    LOG_DEBUG("DEL - Deleted: ", deleted, "/", keys.size());
+    return out.integer(deleted);
 }
 
 // -------------------- EXISTS --------------------
-std::string exists(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] EXISTS operation - Key: " << key << std::endl;
-    
-    bool found = db.exists(key);
-    std::cout << "[" << getTimestamp() << "] [INFO] EXISTS - Key: " << key 
-              << ", Exists: " << (found ? "YES" : "NO") << std::endl;
-    return found ? ":1" : ":0";
+void exists(RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out) {
+    LOG_DEBUG("EXISTS operation - Keys count: ", keys.size());
+
+    // like redis a key given twice is counted twice
+    size_t found = keys.size() == 1 ? db.exists(keys[0]) : db.existsMany(keys);
+    LOG_DEBUG("EXISTS - Found: ", found, "/", keys.size());
+    return out.integer(found);
+}
+
+// -------------------- SCAN --------------------
+void scan(RedisHashMap& db, std::span<const std::string_view> args, ReplyWriter& out) {
+    scanner::Options opts;
+    if (!scanner::parseOptions(args, opts, out)) return;
+
+    // MATCH filters what one call found, so a call may come back with fewer keys or none at
+    // all while the cursor still moves on, like in redis
+    std::vector<std::string> keys;
+    uint64_t next = db.scan(opts.cursor, opts.count, keys);
+    LOG_DEBUG("SCAN - Cursor: ", opts.cursor, " -> ", next, ", Keys visited: ", keys.size());
+    scanner::reply(out, next, keys, opts.pattern);
 }
 
 // -------------------- APPEND --------------------
-std::string append(RedisHashMap& db, const std::string& key, const std::string& value) {
-    std::cout << "[" << getTimestamp() << "] [INFO] APPEND operation - Key: " << key 
-              << ", Append length: " << value.size() << std::endl;
+void append(RedisHashMap& db, std::string_view key, std::string_view value, ReplyWriter& out) {
+    LOG_DEBUG("APPEND operation - Key: ", key, ", Append length: ", value.size());
     
-    RedisObject* obj = db.get(key);
-
-    if (!obj) {
-        // key doesn't exist -> set new string
-        RedisObject newObj(value);
-        db.add(key, newObj);
-        std::cout << "[" << getTimestamp() << "] [INFO] APPEND - New key created: " << key 
-                  << ", Final length: " << value.size() << std::endl;
-        return ":" + std::to_string(value.size());
+    auto [obj, created] = db.getOrCreate(key, [&] { return RedisObject::stringValue(value); });
+    if (created) {
+        // key didn't exist -> it is set to the new string
+        LOG_DEBUG("APPEND - New key created: ", key, ", Final length: ", value.size());
+        return out.integer(value.size());
     }
 
     if (obj->getType() != RedisType::STRING) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] APPEND - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("APPEND - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    // Modify in-place
-    std::string* strPtr = static_cast<std::string*>(obj->getPtr());
-    size_t oldLen = strPtr->size();
-    strPtr->append(value);
+    // Modify in-place, an INT encoded value becomes plain bytes again
+    size_t oldLen = obj->strSize();
+    obj->append(value);
     
-    std::cout << "[" << getTimestamp() << "] [INFO] APPEND - SUCCESS - Key: " << key 
-              << ", Old length: " << oldLen << ", New length: " << strPtr->size() << std::endl;
+    LOG_DEBUG("APPEND - SUCCESS - Key: ", key, ", Old length: ", oldLen, ", New length: ",
+              obj->str().size());
 
-    return ":" + std::to_string(strPtr->size());
+    return out.integer(obj->str().size());
 }
 
 // -------------------- STRLEN --------------------
-std::string strlen_(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] STRLEN operation - Key: " << key << std::endl;
+void strlen_(RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("STRLEN operation - Key: ", key);
     
     RedisObject* obj = db.get(key);
     if (!obj) {
-        std::cout << "[" << getTimestamp() << "] [WARN] STRLEN - Key not found: " << key << std::endl;
-        return ":0";
+        LOG_DEBUG("STRLEN - Key not found: ", key);
+        return out.integer(0);
     }
     if (obj->getType() != RedisType::STRING) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] STRLEN - Wrong type for key: " << key << std::endl;
-        return "-ERR wrong type";
+        LOG_DEBUG("STRLEN - Wrong type for key: ", key);
+        return out.error("ERR wrong type");
     }
 
-    size_t len = obj->getValue<std::string>().size();
-    std::cout << "[" << getTimestamp() << "] [INFO] STRLEN - Key: " << key 
-              << ", Length: " << len << std::endl;
-    return ":" + std::to_string(len);
+    size_t len = obj->strSize();
+    LOG_DEBUG("STRLEN - Key: ", key, ", Length: ", len);
+    return out.integer(len);
+}
+
+// -------------------- lock-free readers --------------------
+// read optimized mode, same replies as above but answered from the key's snapshot without locks
+void getSnapshot(const RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    const ReadSnapshot* snap = db.snapshot(key);
+    LOG_DEBUG("GET (lock-free) - Key: ", key, ", Found: ", (snap ? "YES" : "NO"));
+    if (!snap) return out.nil();
+    if (snap->type != RedisType::STRING) return out.error("ERR wrong type");
+    if (snap->value.intEncoded()) return out.bulk(snap->value.getInt());
+    out.bulk(snap->value.str());
+}
+
+void existsSnapshot(const RedisHashMap& db, std::span<const std::string_view> keys, ReplyWriter& out) {
+    size_t found = 0;
+    for (std::string_view key : keys) found += db.snapshot(key) != nullptr;
+    LOG_DEBUG("EXISTS (lock-free) - Keys count: ", keys.size(), ", Found: ", found);
+    return out.integer(found);
+}
+
+void strlenSnapshot(const RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    const ReadSnapshot* snap = db.snapshot(key);
+    LOG_DEBUG("STRLEN (lock-free) - Key: ", key, ", Found: ", (snap ? "YES" : "NO"));
+    if (!snap) return out.integer(0);
+    if (snap->type != RedisType::STRING) return out.error("ERR wrong type");
+    return out.integer(snap->value.strSize());
 }
 
 // ---------- Integer helpers ----------
-static bool parseInt(const std::string& s, long long& out) {
-    try {
-        size_t idx = 0;
-        out = std::stoll(s, &idx);
-        return idx == s.size(); // ensure fully parsed
-    } catch (...) {
-        return false;
-    }
+static bool parseInt(std::string_view s, long long& out) {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size(); // ensure fully parsed
 }
 
 // -------------------- INCRBY (core) --------------------
-static std::string incrByInternal(RedisHashMap& db, const std::string& key, long long amount) {
-    RedisObject* obj = db.get(key);
-    long long current = 0;
-
-    if (obj) {
+// the value is kept in the INT encoding from the first increment on, so a counter is never
+// parsed or formatted while it is only being counted
+static void incrByInternal(RedisHashMap& db, std::string_view key, long long amount, ReplyWriter& out) {
+    // key doesn't exist, it is created as the counter
+    auto [obj, created] = db.getOrCreate(key, [&] { return RedisObject::stringValue(amount); });
+    long long current = amount;
+
+    if (!created) {
         if (obj->getType() != RedisType::STRING) {
-            std::cout << "[" << getTimestamp() << "] [ERROR] INCRBY - Wrong type for key: " << key << std::endl;
-            return "-ERR wrong type";
+            LOG_DEBUG("INCRBY - Wrong type for key: ", key);
+            return out.error("ERR wrong type");
         }
 
-        std::string* valPtr = static_cast<std::string*>(obj->getPtr());
-        if (!parseInt(*valPtr, current)) {
-            std::cout << "[" << getTimestamp() << "] [ERROR] INCRBY - Non-integer value for key: " << key 
-                      << ", Value: " << *valPtr << std::endl;
-            return "-ERR value is not an integer or out of range";
+        if (obj->intEncoded()) {
+            current = obj->getInt();
+        } else if (!parseInt(obj->str(), current)) {
+            LOG_DEBUG("INCRBY - Non-integer value for key: ", key, ", Value length: ", obj->str().size());
+            return out.error("ERR value is not an integer or out of range");
+        }
+
+        if ((amount > 0 && current > LLONG_MAX - amount) || (amount < 0 && current < LLONG_MIN - amount)) {
+            LOG_DEBUG("INCRBY - Overflow for key: ", key, ", Value: ", current, ", Amount: ", amount);
+            return out.error("ERR increment or decrement would overflow");
         }
 
         current += amount;
-        *valPtr = std::to_string(current); // modify in-place
-    } else {
-        // key doesn't exist, create new string
-        RedisObject newObj(std::to_string(amount));
-        db.add(key, newObj);
-        current = amount;
+        obj->setInt(current); // modify in-place
     }
 
-    std::cout << "[" << getTimestamp() << "] [INFO] INCRBY - Key: " << key 
-              << ", Amount: " << amount << ", New value: " << current << std::endl;
-    return ":" + std::to_string(current);
+    LOG_DEBUG("INCRBY - Key: ", key, ", Amount: ", amount, ", New value: ", current);
+    return out.integer(current);
 }
 
 // -------------------- INCR --------------------
-std::string incr(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] INCR operation - Key: " << key << std::endl;
-    return incrByInternal(db, key, 1);
+void incr(RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("INCR operation - Key: ", key);
+    return incrByInternal(db, key, 1, out);
 }
 
 // -------------------- INCRBY --------------------
-std::string incrby(RedisHashMap& db, const std::string& key, const std::string& amountStr) {
-    std::cout << "[" << getTimestamp() << "] [INFO] INCRBY operation - Key: " << key 
-              << ", Amount: " << amountStr << std::endl;
+void incrby(RedisHashMap& db, std::string_view key, std::string_view amountStr, ReplyWriter& out) {
+    LOG_DEBUG("INCRBY operation - Key: ", key, ", Amount: ", amountStr);
     
     long long amount;
     if (!parseInt(amountStr, amount)) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] INCRBY - Invalid amount: " << amountStr << std::endl;
-        return "-ERR value is not an integer or out of range";
+        LOG_DEBUG("INCRBY - Invalid amount: ", amountStr);
+        return out.error("ERR value is not an integer or out of range");
     }
-    return incrByInternal(db, key, amount);
+    return incrByInternal(db, key, amount, out);
 }
 
 // -------------------- DECR --------------------
-std::string decr(RedisHashMap& db, const std::string& key) {
-    std::cout << "[" << getTimestamp() << "] [INFO] DECR operation - Key: " << key << std::endl;
-    return incrByInternal(db, key, -1);
+void decr(RedisHashMap& db, std::string_view key, ReplyWriter& out) {
+    LOG_DEBUG("DECR operation - Key: ", key);
+    return incrByInternal(db, key, -1, out);
 }
 
 // -------------------- DECRBY --------------------
-std::string decrby(RedisHashMap& db, const std::string& key, const std::string& amountStr) {
-    std::cout << "[" << getTimestamp() << "] [INFO] DECRBY operation - Key: " << key 
-              << ", Amount: " << amountStr << std::endl;
+void decrby(RedisHashMap& db, std::string_view key, std::string_view amountStr, ReplyWriter& out) {
+    LOG_DEBUG("DECRBY operation - Key: ", key, ", Amount: ", amountStr);
     
     long long amount;
     if (!parseInt(amountStr, amount)) {
-        std::cout << "[" << getTimestamp() << "] [ERROR] DECRBY - Invalid amount: " << amountStr << std::endl;
-        return "-ERR value is not an integer or out of range";
+        LOG_DEBUG("DECRBY - Invalid amount: ", amountStr);
+        return out.error("ERR value is not an integer or out of range");
+    }
+    if (amount == LLONG_MIN) {
+        LOG_DEBUG("DECRBY - Amount can not be negated: ", amountStr);
+        return out.error("ERR decrement would overflow");
+    }
+    return incrByInternal(db, key, -amount, out);
+}
+
+// -------------------- INCRBYFLOAT --------------------
+// parses the whole string as a finite long double, no leading spaces like redis
+static bool parseLongDouble(std::string_view s, long double& out) {
+    if (s.empty() || s.size() > 5000 || std::isspace((unsigned char)s[0])) return false;
+    std::string buf(s);
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtold(buf.c_str(), &end);
+    return end == buf.c_str() + buf.size() && errno != ERANGE && std::isfinite(out);
+}
+
+void incrbyfloat(RedisHashMap& db, std::string_view key, std::string_view amountStr, ReplyWriter& out) {
+    LOG_DEBUG("INCRBYFLOAT operation - Key: ", key, ", Amount: ", amountStr);
+
+    long double amount;
+    if (!parseLongDouble(amountStr, amount)) {
+        LOG_DEBUG("INCRBYFLOAT - Invalid amount: ", amountStr);
+        return out.error("ERR value is not a valid float");
     }
-    return incrByInternal(db, key, -amount);
+
+    RedisObject* obj = db.get(key);
+    long double current = 0;
+    if (obj) {
+        if (obj->getType() != RedisType::STRING) {
+            LOG_DEBUG("INCRBYFLOAT - Wrong type for key: ", key);
+            return out.error("ERR wrong type");
+        }
+        if (obj->intEncoded()) current = (long double)obj->getInt();
+        else if (!parseLongDouble(obj->str(), current)) {
+            LOG_DEBUG("INCRBYFLOAT - Non-float value for key: ", key);
+            return out.error("ERR value is not a valid float");
+        }
+    }
+
+    current += amount;
+    if (!std::isfinite(current)) {
+        LOG_DEBUG("INCRBYFLOAT - Overflow for key: ", key);
+        return out.error("ERR increment would produce NaN or Infinity");
+    }
+
+    // fixed point with 17 decimals and the trailing zeros cut off, like redis. a whole number
+    // ends up as plain digits and so goes back to the INT encoding
+    char buf[5120];
+    int n = std::snprintf(buf, sizeof(buf), "%.17Lf", current);
+    std::string_view result(buf, n > 0 ? std::min<size_t>((size_t)n, sizeof(buf) - 1) : 0);
+    if (result.find('.') != std::string_view::npos) {
+        while (result.back() == '0') result.remove_suffix(1);
+        if (result.back() == '.') result.remove_suffix(1);
+    }
+    if (result == "-0") result = "0";
+
+    if (obj) *obj = RedisObject::stringValue(result);
+    else db.emplace(key, RedisObject::stringValue(result));
+    LOG_DEBUG("INCRBYFLOAT - Key: ", key, ", New value: ", result);
+    out.bulk(result);
 }
 
 // -------------------- RENAME --------------------
-std::string rename(RedisHashMap& db, const std::string& oldKey, const std::string& newKey) {
-    std::cout << "[" << getTimestamp() << "] [INFO] RENAME operation - Old key: " << oldKey 
-              << ", New key: " << newKey << std::endl;
+void rename(RedisHashMap& db, std::string_view oldKey, std::string_view newKey, ReplyWriter& out) {
+    LOG_DEBUG("RENAME operation - Old key: ", oldKey, ", New key: ", newKey);
     
     bool success = db.rename(oldKey, newKey);
-    std::cout << "[" << getTimestamp() << "] [INFO] RENAME - " << (success ? "SUCCESS" : "KEY_NOT_FOUND") 
-              << " - Old: " << oldKey << ", New: " << newKey << std::endl;
-    return success ? "+OK" : "-ERR key does not exist";
+    LOG_DEBUG("RENAME - ", (success ? "SUCCESS" : "KEY_NOT_FOUND"), " - Old: ", oldKey, ", New: ",
+              newKey);
+    if (!success) return out.error("ERR key does not exist");
+    out.ok();
 }
 
 // -------------------- COPY --------------------
-std::string copy(RedisHashMap& db, const std::string& sourceKey, const std::string& destKey) {
-    std::cout << "[" << getTimestamp() << "] [INFO] COPY operation - Source: " << sourceKey 
-              << ", Destination: " << destKey << std::endl;
+void copy(RedisHashMap& db, std::string_view sourceKey, std::string_view destKey, ReplyWriter& out) {
+    LOG_DEBUG("COPY operation - Source: ", sourceKey, ", Destination: ", destKey);
     
     bool success = db.copy(sourceKey, destKey);
-    std::cout << "[" << getTimestamp() << "] [INFO] COPY - " << (success ? "SUCCESS" : "SOURCE_NOT_FOUND") 
-              << " - Source: " << sourceKey << ", Dest: " << destKey << std::endl;
-    return success ? "+OK" : "-ERR source key does not exist";
+    LOG_DEBUG("COPY - ", (success ? "SUCCESS" : "SOURCE_NOT_FOUND"), " - Source: ", sourceKey,
+              ", Dest: ", destKey);
+    if (!success) return out.error("ERR source key does not exist");
+    out.ok();
 }
 
 // -------------------- EXPIRE (stub only) --------------------
-std::string expire(RedisHashMap& db, const std::string& key, const std::string& seconds) {
-    std::cout << "[" << getTimestamp() << "] [INFO] EXPIRE operation (stub) - Key: " << key 
-              << ", Seconds: " << seconds << std::endl;
+void expire(RedisHashMap& db, std::string_view key, std::string_view seconds, ReplyWriter& out) {
+    LOG_DEBUG("EXPIRE operation (stub) - Key: ", key, ", Seconds: ", seconds);
     // No implementation yet
-    return "+OK (expire stub)";
+    out.simple("OK (expire stub)");
 }
 
 } // namespace stringstore